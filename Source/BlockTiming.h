@@ -0,0 +1,203 @@
+/*
+  ==============================================================================
+
+    BlockTiming.h
+
+    Per-instance histogram of processBlock() cost. The audio thread is the
+    only writer; the editor polls a summary and can ask for a reset or a dump.
+    Set AARROW_BLOCK_TIMING to 0 to compile all of it out.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#ifndef AARROW_BLOCK_TIMING
+ #define AARROW_BLOCK_TIMING 1
+#endif
+
+#if AARROW_BLOCK_TIMING
+
+//==============================================================================
+class BlockTimingHistogram
+{
+public:
+    // durations are binned on a log scale (4 bins per octave of nanoseconds),
+    // load (time spent / block deadline) linearly in 1% steps
+    static constexpr int numTimeBins = 128;
+    static constexpr int numLoadBins = 256;
+
+    struct Summary
+    {
+        juce::uint64 blocks = 0;
+        double meanMicros = 0.0, p99Micros = 0.0, maxMicros = 0.0;
+        double meanLoad = 0.0, p99Load = 0.0, maxLoad = 0.0;
+    };
+
+    BlockTimingHistogram() { clear(); }
+
+    void prepare(double newSampleRate) noexcept
+    {
+        sampleRate.store(newSampleRate, std::memory_order_relaxed);
+        reset();
+    }
+
+    // called from any thread, the audio thread performs the actual clear
+    void reset() noexcept { resetRequested.store(true, std::memory_order_release); }
+
+    //==============================================================================
+    // audio thread only
+    void record(juce::int64 elapsedTicks, int numSamples) noexcept
+    {
+        if (resetRequested.exchange(false, std::memory_order_acquire))
+            clear();
+
+        auto nanos = (juce::uint64) ((double) juce::jmax((juce::int64) 0, elapsedTicks) * nanosPerTick());
+        auto deadlineNanos = numSamples * 1.0e9 / sampleRate.load(std::memory_order_relaxed);
+        auto loadPercent = deadlineNanos > 0.0 ? (juce::uint64) (100.0 * (double) nanos / deadlineNanos) : 0;
+
+        bump(timeBins[(size_t) timeBinFor(nanos)]);
+        bump(loadBins[(size_t) juce::jmin((juce::uint64) numLoadBins - 1, loadPercent)]);
+
+        blocks.store(blocks.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        totalNanos.store(totalNanos.load(std::memory_order_relaxed) + nanos, std::memory_order_relaxed);
+        totalLoadPercent.store(totalLoadPercent.load(std::memory_order_relaxed) + loadPercent, std::memory_order_relaxed);
+
+        if (nanos > maxNanos.load(std::memory_order_relaxed))
+            maxNanos.store(nanos, std::memory_order_relaxed);
+        if (loadPercent > maxLoadPercent.load(std::memory_order_relaxed))
+            maxLoadPercent.store(loadPercent, std::memory_order_relaxed);
+    }
+
+    struct ScopedTimer
+    {
+        ScopedTimer(BlockTimingHistogram& h, int samples) noexcept
+            : histogram(h), numSamples(samples), start(juce::Time::getHighResolutionTicks()) {}
+
+        ~ScopedTimer() { histogram.record(juce::Time::getHighResolutionTicks() - start, numSamples); }
+
+        BlockTimingHistogram& histogram;
+        const int numSamples;
+        const juce::int64 start;
+    };
+
+    //==============================================================================
+    Summary getSummary() const noexcept
+    {
+        Summary s;
+        s.blocks = blocks.load(std::memory_order_relaxed);
+
+        if (s.blocks == 0)
+            return s;
+
+        s.meanMicros = (double) totalNanos.load(std::memory_order_relaxed) / (double) s.blocks / 1000.0;
+        s.maxMicros = (double) maxNanos.load(std::memory_order_relaxed) / 1000.0;
+        s.meanLoad = (double) totalLoadPercent.load(std::memory_order_relaxed) / (double) s.blocks;
+        s.maxLoad = (double) maxLoadPercent.load(std::memory_order_relaxed);
+        s.p99Micros = upperEdgeOfTimeBin(percentileBin(timeBins, s.blocks)) / 1000.0;
+        s.p99Load = (double) percentileBin(loadBins, s.blocks) + 1.0;
+        return s;
+    }
+
+    bool dumpToFile(const juce::File& file) const
+    {
+        auto s = getSummary();
+        juce::String text;
+
+        text << "blocks," << juce::String((juce::int64) s.blocks) << juce::newLine
+             << "mean_us," << s.meanMicros << juce::newLine
+             << "p99_us," << s.p99Micros << juce::newLine
+             << "max_us," << s.maxMicros << juce::newLine
+             << "mean_load_percent," << s.meanLoad << juce::newLine
+             << "p99_load_percent," << s.p99Load << juce::newLine
+             << "max_load_percent," << s.maxLoad << juce::newLine
+             << juce::newLine << "time_bin_upper_us,count" << juce::newLine;
+
+        for (int i = 0; i < numTimeBins; ++i)
+            if (auto count = timeBins[(size_t) i].load(std::memory_order_relaxed))
+                text << upperEdgeOfTimeBin(i) / 1000.0 << "," << (juce::int64) count << juce::newLine;
+
+        text << juce::newLine << "load_bin_percent,count" << juce::newLine;
+
+        for (int i = 0; i < numLoadBins; ++i)
+            if (auto count = loadBins[(size_t) i].load(std::memory_order_relaxed))
+                text << i << "," << (juce::int64) count << juce::newLine;
+
+        return file.replaceWithText(text);
+    }
+
+private:
+    using Counter = std::atomic<juce::uint32>;
+
+    static void bump(Counter& c) noexcept { c.store(c.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed); }
+
+    static int timeBinFor(juce::uint64 nanos) noexcept
+    {
+        auto n = (juce::uint32) juce::jmin(nanos, (juce::uint64) 0xffffffff);
+
+        if (n < 4)
+            return (int) n;
+
+        auto octave = juce::findHighestSetBit(n);
+        auto fraction = (int) ((n >> (octave - 2)) & 3);
+        return juce::jmin(numTimeBins - 1, octave * 4 + fraction);
+    }
+
+    static double upperEdgeOfTimeBin(int bin) noexcept
+    {
+        if (bin < 4)
+            return bin + 1.0;
+
+        auto octave = bin / 4;
+        return std::ldexp(1.0 + ((bin % 4) + 1) * 0.25, octave);
+    }
+
+    template <size_t N>
+    static int percentileBin(const std::array<Counter, N>& bins, juce::uint64 total) noexcept
+    {
+        auto target = total - total / 100;
+        juce::uint64 seen = 0;
+
+        for (size_t i = 0; i < N; ++i)
+            if ((seen += bins[i].load(std::memory_order_relaxed)) >= target)
+                return (int) i;
+
+        return (int) N - 1;
+    }
+
+    void clear() noexcept
+    {
+        for (auto& b : timeBins) b.store(0, std::memory_order_relaxed);
+        for (auto& b : loadBins) b.store(0, std::memory_order_relaxed);
+
+        blocks.store(0, std::memory_order_relaxed);
+        totalNanos.store(0, std::memory_order_relaxed);
+        totalLoadPercent.store(0, std::memory_order_relaxed);
+        maxNanos.store(0, std::memory_order_relaxed);
+        maxLoadPercent.store(0, std::memory_order_relaxed);
+    }
+
+    static double nanosPerTick() noexcept
+    {
+        static const double value = 1.0e9 / (double) juce::Time::getHighResolutionTicksPerSecond();
+        return value;
+    }
+
+    std::atomic<double> sampleRate{ 44100.0 };
+    std::atomic<bool> resetRequested{ false };
+
+    std::array<Counter, numTimeBins> timeBins;
+    std::array<Counter, numLoadBins> loadBins;
+    std::atomic<juce::uint64> blocks, totalNanos, totalLoadPercent, maxNanos, maxLoadPercent;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(BlockTimingHistogram)
+};
+
+ #define AARROW_TIME_BLOCK(histogram, numSamples) \
+    const BlockTimingHistogram::ScopedTimer JUCE_JOIN_MACRO(blockTimer_, __LINE__) (histogram, numSamples);
+
+#else
+ #define AARROW_TIME_BLOCK(histogram, numSamples)
+#endif
@@ -0,0 +1,137 @@
+/*
+  ==============================================================================
+
+    ConfigPublisher.h
+
+    Gets configuration that doesn't fit in an atomic (patterns, tables...)
+    from the message thread to the audio thread without locks on the audio
+    side. The writer builds a fresh immutable Config and swaps it in; the
+    audio thread reads whatever is current at the start of a block and can
+    use it until the end of that block. Replaced configs are deleted later on
+    a timer, once the audio thread can't still be looking at them.
+
+    The audio thread bumps an epoch counter as it enters and leaves a block
+    (odd = inside). A config retired while the epoch was even can't be in use;
+    one retired while it was odd is free once the epoch has moved on.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+template <typename Config>
+class ConfigPublisher : private juce::Timer
+{
+public:
+    ConfigPublisher() = default;
+
+    ~ConfigPublisher() override
+    {
+        stopTimer();
+
+        for (auto& r : retired)
+            delete r.config;
+
+        delete latest.load();
+    }
+
+    //==============================================================================
+    // any thread but the audio thread: copies the current config, lets `change`
+    // edit the copy, and publishes it
+    template <typename Fn>
+    void update(Fn&& change)
+    {
+        const juce::ScopedLock sl(lock);
+
+        auto next = std::make_unique<Config>(*latest.load(std::memory_order_relaxed));
+        change(*next);
+
+        auto* old = latest.exchange(next.release(), std::memory_order_seq_cst);
+        retired.add({ old, epoch.load(std::memory_order_seq_cst) });
+
+        reclaim();
+    }
+
+    // writer side: a look at the current config. Writers are the only ones that
+    // free configs, so holding the lock is enough here.
+    template <typename Fn>
+    void inspect(Fn&& fn) const
+    {
+        const juce::ScopedLock sl(lock);
+        fn(*latest.load(std::memory_order_relaxed));
+    }
+
+    //==============================================================================
+    // audio thread only (the epoch assumes a single reader): wait-free. The reference
+    // stays valid until the ScopedRead goes away, so take one per block.
+    class ScopedRead
+    {
+    public:
+        explicit ScopedRead(ConfigPublisher& p) noexcept
+            : publisher(p)
+        {
+            publisher.epoch.fetch_add(1, std::memory_order_seq_cst);
+            config = publisher.latest.load(std::memory_order_seq_cst);
+        }
+
+        ~ScopedRead() noexcept
+        {
+            publisher.epoch.fetch_add(1, std::memory_order_release);
+        }
+
+        const Config& operator*() const noexcept { return *config; }
+        const Config* operator->() const noexcept { return config; }
+
+    private:
+        ConfigPublisher& publisher;
+        const Config* config;
+
+        JUCE_DECLARE_NON_COPYABLE(ScopedRead)
+    };
+
+private:
+    struct Retired
+    {
+        const Config* config;
+        juce::uint64 epoch;
+    };
+
+    // called with the lock held
+    void reclaim()
+    {
+        auto now = epoch.load(std::memory_order_acquire);
+
+        for (int i = retired.size(); --i >= 0;)
+        {
+            auto r = retired.getUnchecked(i);
+
+            if ((r.epoch & 1) == 0 || r.epoch != now)
+            {
+                delete r.config;
+                retired.remove(i);
+            }
+        }
+
+        if (retired.isEmpty())
+            stopTimer();
+        else if (!isTimerRunning())
+            startTimer(50);
+    }
+
+    void timerCallback() override
+    {
+        const juce::ScopedLock sl(lock);
+        reclaim();
+    }
+
+    std::atomic<const Config*> latest{ new Config() };
+    std::atomic<juce::uint64> epoch{ 0 };
+
+    juce::CriticalSection lock;
+    juce::Array<Retired> retired;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ConfigPublisher)
+};
@@ -0,0 +1,69 @@
+/*
+  ==============================================================================
+
+    Groove.cpp
+
+  ==============================================================================
+*/
+
+#include "Groove.h"
+
+namespace groove
+{
+
+//==============================================================================
+juce::StringArray getNames()
+{
+    juce::StringArray names;
+
+    for (auto& t : templates)
+        names.add(t.name);
+
+    return names;
+}
+
+juce::Result parse(const juce::String& source, Template& result)
+{
+    auto tokens = juce::StringArray::fromTokens(source, false);
+    tokens.removeEmptyStrings();
+
+    if (tokens.size() > numSteps)
+        return juce::Result::fail("Grooves can be up to " + juce::String(numSteps) + " steps long");
+
+    Template groove;
+
+    for (int i = 0; i < tokens.size(); ++i)
+    {
+        auto stepNumber = juce::String(i + 1);
+        auto offsetText = tokens[i].upToFirstOccurrenceOf(":", false, false);
+        auto velocityText = tokens[i].fromFirstOccurrenceOf(":", false, false);
+
+        if (!offsetText.containsOnly("0123456789") || offsetText.isEmpty()
+            || !velocityText.containsOnly("0123456789") || (tokens[i].containsChar(':') && velocityText.isEmpty()))
+            return juce::Result::fail("Step " + stepNumber + ": steps look like 20 or 20:70");
+
+        auto offset = offsetText.getIntValue();
+        auto velocity = velocityText.isEmpty() ? 100 : velocityText.getIntValue();
+
+        if (offset > maxOffsetPercent)
+            return juce::Result::fail("Step " + stepNumber + ": offsets go up to " + juce::String(maxOffsetPercent) + "%");
+
+        if (velocity > maxVelocityPercent)
+            return juce::Result::fail("Step " + stepNumber + ": velocities go up to " + juce::String(maxVelocityPercent) + "%");
+
+        groove.offset[(size_t) i] = (juce::uint8) offset;
+        groove.velocity[(size_t) i] = (juce::uint8) velocity;
+    }
+
+    // a short map repeats to fill the bar
+    for (int i = tokens.size(); i < numSteps && tokens.size() > 0; ++i)
+    {
+        groove.offset[(size_t) i] = groove.offset[(size_t) (i % tokens.size())];
+        groove.velocity[(size_t) i] = groove.velocity[(size_t) (i % tokens.size())];
+    }
+
+    result = groove;
+    return juce::Result::ok();
+}
+
+} // namespace groove
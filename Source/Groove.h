@@ -0,0 +1,145 @@
+/*
+  ==============================================================================
+
+    Groove.h
+
+    Swing and groove templates. A groove moves each of 16 steps later by
+    part of a step and scales its velocity; MPC-style swing (50% straight,
+    66% triplet feel, 75% dotted) pushes every second step on top of that.
+
+    Whenever the step length, template or swing changes, the offsets are
+    turned into samples once, so playing a step is one table read. Notes
+    that a groove pushes past the end of the block wait in a NoteQueue and
+    go out in a later block.
+
+    Custom maps are up to 16 "offset[:velocity]" tokens in percent, e.g.
+    "0 20 0 20:70" (repeated to fill 16 steps).
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+namespace groove
+{
+
+constexpr int numSteps = 16;
+constexpr int maxOffsetPercent = 75;    // steps only move later, and never past the next one
+constexpr int maxVelocityPercent = 200;
+
+struct Template
+{
+    std::array<juce::uint8, numSteps> offset{};         // percent of a step
+    std::array<juce::uint8, numSteps> velocity{ 100, 100, 100, 100, 100, 100, 100, 100,
+                                                100, 100, 100, 100, 100, 100, 100, 100 };
+};
+
+struct Named
+{
+    const char* name;
+    Template groove;
+};
+
+inline constexpr Named templates[] =
+{
+    { "Off",     {} },
+    { "Lazy",    { { 0, 10, 4, 10, 0, 10, 4, 10, 0, 10, 4, 10, 0, 10, 4, 10 },
+                   { 100, 90, 95, 90, 100, 90, 95, 90, 100, 90, 95, 90, 100, 90, 95, 90 } } },
+    { "Shuffle", { { 0, 33, 0, 33, 0, 33, 0, 33, 0, 33, 0, 33, 0, 33, 0, 33 },
+                   { 100, 70, 90, 70, 100, 70, 90, 70, 100, 70, 90, 70, 100, 70, 90, 70 } } },
+    { "Accent",  { {},
+                   { 115, 70, 85, 70, 100, 70, 85, 70, 110, 70, 85, 70, 100, 70, 85, 75 } } },
+    { "Drag",    { { 0, 0, 12, 0, 0, 0, 12, 6, 0, 0, 12, 0, 0, 0, 12, 6 },
+                   { 110, 80, 90, 80, 105, 80, 90, 85, 110, 80, 90, 80, 105, 80, 90, 85 } } },
+    { "Custom",  {} },      // the map from setGroove()
+};
+
+constexpr int numTemplates = (int) (sizeof(templates) / sizeof(templates[0]));
+constexpr int customTemplate = numTemplates - 1;
+
+juce::StringArray getNames();
+
+// message thread: an empty source is a straight groove
+juce::Result parse(const juce::String& source, Template& result);
+
+//==============================================================================
+// Per-step sample offsets and velocity scalars for the current settings
+class Table
+{
+public:
+    void update(int stepSamples, int templateIndex, int swingPercent, const Template& custom, juce::uint32 customVersion) noexcept
+    {
+        if (stepSamples == lastStep && templateIndex == lastTemplate && swingPercent == lastSwing && customVersion == lastVersion)
+            return;
+
+        lastStep = stepSamples;
+        lastTemplate = templateIndex;
+        lastSwing = swingPercent;
+        lastVersion = customVersion;
+
+        const auto& t = templateIndex == customTemplate ? custom : templates[juce::jlimit(0, numTemplates - 1, templateIndex)].groove;
+
+        // MPC swing: the second of each pair lands at swing% of the pair
+        auto swing = 2.0 * juce::jlimit(50, 75, swingPercent) / 100.0 - 1.0;
+
+        for (int i = 0; i < numSteps; ++i)
+        {
+            auto shift = juce::jmin(maxOffsetPercent / 100.0, t.offset[(size_t) i] / 100.0 + ((i & 1) ? swing : 0.0));
+
+            offsets[(size_t) i] = juce::roundToInt(shift * stepSamples);
+            velocities[(size_t) i] = t.velocity[(size_t) i] / 100.0f;
+        }
+    }
+
+    int offset(int step) const noexcept { return offsets[(size_t) (step & (numSteps - 1))]; }
+    float velocity(int step) const noexcept { return velocities[(size_t) (step & (numSteps - 1))]; }
+
+private:
+    std::array<int, numSteps> offsets{};
+    std::array<float, numSteps> velocities{};
+
+    int lastStep = -1, lastTemplate = -1, lastSwing = -1;
+    juce::uint32 lastVersion = 0;
+};
+
+//==============================================================================
+// Notes scheduled for later, oldest first, timed in samples since playback began.
+// Times are pushed in order, so it's a plain ring.
+class NoteQueue
+{
+public:
+    static constexpr int capacity = 64;
+
+    struct Note
+    {
+        juce::int64 time;
+        juce::uint8 data[3];
+    };
+
+    void clear() noexcept { head = count = 0; }
+    bool isEmpty() const noexcept { return count == 0; }
+    const Note& front() const noexcept { return notes[(size_t) head]; }
+    void pop() noexcept { head = (head + 1) % capacity; --count; }
+
+    bool push(juce::int64 time, const juce::MidiMessage& m) noexcept
+    {
+        jassert(m.getRawDataSize() == 3);
+        jassert(count == 0 || notes[(size_t) ((head + count - 1) % capacity)].time <= time);
+
+        if (count == capacity)
+            return false;
+
+        auto& n = notes[(size_t) ((head + count++) % capacity)];
+        n.time = time;
+        std::memcpy(n.data, m.getRawData(), 3);
+        return true;
+    }
+
+private:
+    std::array<Note, capacity> notes;
+    int head = 0, count = 0;
+};
+
+} // namespace groove
@@ -0,0 +1,167 @@
+/*
+  ==============================================================================
+
+    MidiCapture.cpp
+
+  ==============================================================================
+*/
+
+#include "MidiCapture.h"
+
+//==============================================================================
+MidiCapture::MidiCapture() : juce::Thread("Arp MIDI capture")
+{
+}
+
+MidiCapture::~MidiCapture()
+{
+    stopThread(1000);
+}
+
+void MidiCapture::prepare(double newSampleRate)
+{
+    const juce::ScopedLock sl(lock);
+    sampleRate = newSampleRate;
+}
+
+void MidiCapture::setRecording(bool shouldRecord)
+{
+    // the buffers and the drain thread only appear once somebody actually records,
+    // so instances that never capture cost nothing to construct
+    if (shouldRecord && !isThreadRunning())
+    {
+        buffer.allocate((size_t) fifoSize, false);
+        captured.ensureStorageAllocated(fifoSize);
+        startThread();
+    }
+
+    recording.store(shouldRecord, std::memory_order_release);
+}
+
+void MidiCapture::push(const juce::MidiMessage& message, juce::int64 samplePosition, double ppqPosition, double bpm, bool hostIsPlaying) noexcept
+{
+    auto size = message.getRawDataSize();
+
+    if (size > 3)   // SysEx isn't something the arp plays
+        return;
+
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite(1, start1, size1, start2, size2);
+
+    if (size1 + size2 == 0)
+    {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    auto& e = buffer[size1 > 0 ? start1 : start2];
+    e.samplePosition = samplePosition;
+    e.ppqPosition = ppqPosition;
+    e.bpm = (float) bpm;
+    e.hostIsPlaying = hostIsPlaying;
+    e.size = (juce::uint8) size;
+    std::memcpy(e.data, message.getRawData(), (size_t) size);
+
+    fifo.finishedWrite(1);
+}
+
+//==============================================================================
+void MidiCapture::run()
+{
+    while (!threadShouldExit())
+    {
+        drain();
+        wait(10);
+    }
+
+    drain();
+}
+
+void MidiCapture::drain()
+{
+    int start1, size1, start2, size2;
+    fifo.prepareToRead(fifo.getNumReady(), start1, size1, start2, size2);
+
+    if (size1 + size2 > 0)
+    {
+        const juce::ScopedLock sl(lock);
+        captured.addArray(buffer.getData() + start1, size1);
+        captured.addArray(buffer.getData() + start2, size2);
+    }
+
+    fifo.finishedRead(size1 + size2);
+}
+
+void MidiCapture::clear()
+{
+    const juce::ScopedLock sl(lock);
+    captured.clearQuick();
+    dropped.store(0, std::memory_order_relaxed);
+}
+
+int MidiCapture::getNumCapturedEvents() const
+{
+    const juce::ScopedLock sl(lock);
+    return captured.size();
+}
+
+//==============================================================================
+bool MidiCapture::writeToFile(const juce::File& file) const
+{
+    juce::MidiMessageSequence track;
+
+    {
+        const juce::ScopedLock sl(lock);
+
+        if (captured.isEmpty())
+            return false;
+
+        // Time zero is the first captured event, or its song position when the host
+        // was playing, so a dragged-out clip lands on the right beat. After that, each
+        // event follows the host's song position for as long as it plays on steadily,
+        // so the file stays on the bar grid through tempo changes. Stopped, looped or
+        // jumped, it follows the sample clock at the tempo of the time instead. A tempo
+        // event goes in wherever the tempo changed.
+        auto tempoOf = [](const Event& e) { return e.bpm > 0.0f ? (double) e.bpm : 120.0; };
+
+        const auto& first = captured.getReference(0);
+        auto bpm = tempoOf(first);
+        auto ticks = first.hostIsPlaying ? juce::jmax(0.0, first.ppqPosition) * ticksPerQuarterNote : 0.0;
+        const Event* previous = nullptr;
+
+        track.addEvent(juce::MidiMessage::tempoMetaEvent(juce::roundToInt(60000000.0 / bpm)), 0.0);
+
+        for (const auto& e : captured)
+        {
+            if (previous != nullptr)
+            {
+                auto clockBeats = (double) (e.samplePosition - previous->samplePosition) * bpm / 60.0 / sampleRate;
+                auto songBeats = e.ppqPosition - previous->ppqPosition;
+                auto steady = previous->hostIsPlaying && e.hostIsPlaying && songBeats >= 0.0
+                           && std::abs(songBeats - clockBeats) <= 0.5 * clockBeats + 1.0;
+
+                ticks += (steady ? songBeats : clockBeats) * ticksPerQuarterNote;
+            }
+
+            if (tempoOf(e) != bpm)
+            {
+                bpm = tempoOf(e);
+                track.addEvent(juce::MidiMessage::tempoMetaEvent(juce::roundToInt(60000000.0 / bpm)), ticks);
+            }
+
+            track.addEvent(juce::MidiMessage(e.data, (int) e.size, ticks));
+            previous = &e;
+        }
+    }
+
+    track.updateMatchedPairs();
+
+    juce::MidiFile midiFile;
+    midiFile.setTicksPerQuarterNote(ticksPerQuarterNote);
+    midiFile.addTrack(track);
+
+    file.deleteFile();
+    juce::FileOutputStream out(file);
+
+    return out.openedOk() && midiFile.writeTo(out);
+}
@@ -0,0 +1,67 @@
+/*
+  ==============================================================================
+
+    MidiCapture.h
+
+    Records everything the arpeggiator sends out. The audio thread pushes
+    fixed-size events into a preallocated FIFO; a background thread drains it
+    into a MidiMessageSequence that the editor can export as a MIDI file.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+class MidiCapture : private juce::Thread
+{
+public:
+    MidiCapture();
+    ~MidiCapture() override;
+
+    void prepare(double newSampleRate);
+
+    void setRecording(bool shouldRecord);
+    bool isRecording() const noexcept { return recording.load(std::memory_order_acquire); }
+
+    // audio thread only: never allocates or blocks, drops the event if the FIFO is full
+    void push(const juce::MidiMessage& message, juce::int64 samplePosition, double ppqPosition, double bpm, bool hostIsPlaying) noexcept;
+
+    //==============================================================================
+    void clear();
+    int getNumCapturedEvents() const;
+    int getNumDroppedEvents() const noexcept { return dropped.load(std::memory_order_relaxed); }
+
+    bool writeToFile(const juce::File& file) const;
+
+private:
+    struct Event
+    {
+        juce::int64 samplePosition;
+        double ppqPosition;
+        float bpm;
+        bool hostIsPlaying;
+        juce::uint8 size;
+        juce::uint8 data[3];
+    };
+
+    void run() override;
+    void drain();
+
+    static constexpr int fifoSize = 8192;
+    static constexpr int ticksPerQuarterNote = 960;
+
+    juce::AbstractFifo fifo{ fifoSize };
+    juce::HeapBlock<Event> buffer;     // allocated by the first setRecording(true)
+
+    std::atomic<bool> recording{ false };
+    std::atomic<int> dropped{ 0 };
+    double sampleRate = 44100.0;
+
+    juce::CriticalSection lock;
+    juce::Array<Event> captured;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MidiCapture)
+};
@@ -0,0 +1,99 @@
+/*
+  ==============================================================================
+
+    MidiClock.cpp
+
+  ==============================================================================
+*/
+
+#include "MidiClock.h"
+#include "MidiMerger.h"
+
+//==============================================================================
+void MidiClock::reset() noexcept
+{
+    numEvents = nextEvent = numTicks = 0;
+    maxErrorSamples = 0.0;
+    running = false;
+}
+
+void MidiClock::process(const juce::AudioPlayHead::CurrentPositionInfo& position, double sampleRate, int numSamples, bool enabled) noexcept
+{
+    numEvents = nextEvent = numTicks = 0;
+    maxErrorSamples = 0.0;
+
+    if (!enabled || !position.isPlaying || position.bpm <= 0.0 || numSamples <= 0)
+    {
+        if (running)
+            add(0, 0xfc);
+
+        running = false;
+        return;
+    }
+
+    const auto samplesPerTick = sampleRate * 60.0 / (position.bpm * ticksPerQuarterNote);
+    const auto startTick = position.ppqPosition * ticksPerQuarterNote;
+
+    // started, looped or jumped: stop, say where we are, and pick up from the next 16th
+    // (Song Position counts 16ths, 6 ticks each). Followers play that 16th on the first tick.
+    if (!running || std::abs(startTick - expectedTick) > 1.0)
+    {
+        if (running)
+            add(0, 0xfc);
+
+        auto sixteenth = juce::jlimit<juce::int64>(0, 16383, (juce::int64) std::ceil(startTick / 6.0 - 1.0e-9));
+        nextTick = sixteenth * 6;
+
+        if (sixteenth == 0)
+            add(0, 0xfa);
+        else
+        {
+            add(0, 0xf2, (int) sixteenth);
+            add(0, 0xfb);
+        }
+
+        running = true;
+    }
+
+    // the ticks in this block, each placed from its own exact time
+    for (;; ++nextTick)
+    {
+        auto exact = ((double) nextTick - startTick) * samplesPerTick;
+
+        // a tick that rounds onto the next block's first sample goes out with that block
+        if (exact >= numSamples - 0.5 || numEvents == maxEventsPerBlock)
+            break;
+
+        auto samplePosition = juce::jlimit(0, numSamples - 1, juce::roundToInt(exact));
+        maxErrorSamples = juce::jmax(maxErrorSamples, std::abs(samplePosition - exact));
+
+        add(samplePosition, 0xf8);
+        ++numTicks;
+    }
+
+    expectedTick = startTick + numSamples / samplesPerTick;
+}
+
+void MidiClock::flushInto(MidiMerger& output, int samplePosition) noexcept
+{
+    for (; nextEvent < numEvents && events[(size_t) nextEvent].samplePosition <= samplePosition; ++nextEvent)
+    {
+        auto& e = events[(size_t) nextEvent];
+        auto added = output.add(juce::MidiMessage(e.data, e.size), e.samplePosition);
+        jassert(added);     // the caller didn't keep room for the clock
+        juce::ignoreUnused(added);
+    }
+}
+
+void MidiClock::add(int samplePosition, juce::uint8 status, int songPosition) noexcept
+{
+    if (numEvents == maxEventsPerBlock)
+        return;
+
+    auto& e = events[(size_t) numEvents++];
+    e.samplePosition = samplePosition;
+    e.data[0] = status;
+    e.data[1] = (juce::uint8) (songPosition & 0x7f);
+    e.data[2] = (juce::uint8) ((songPosition >> 7) & 0x7f);
+    e.size = status == 0xf2 ? 3 : 1;
+}
@@ -0,0 +1,75 @@
+/*
+  ==============================================================================
+
+    MidiClock.h
+
+    MIDI Clock (24 per quarter note) plus Start / Continue / Stop / Song
+    Position for hardware that follows the arp. Every block, the ticks that
+    fall inside it are worked out straight from the playhead's ppq position
+    and tempo, so each one lands on the sample nearest its exact time and
+    errors never add up from block to block. When the host starts, loops or
+    jumps, the clock restarts from the next 16th with a Song Position.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+class MidiMerger;
+
+//==============================================================================
+class MidiClock
+{
+public:
+    static constexpr int ticksPerQuarterNote = 24;
+    static constexpr int maxEventsPerBlock = 64;
+
+    void reset() noexcept;
+    bool isRunning() const noexcept { return running; }
+
+    // audio thread: works out this block's messages. Disabled, or with the host stopped,
+    // it only sends a Stop if the clock was running.
+    void process(const juce::AudioPlayHead::CurrentPositionInfo& position, double sampleRate, int numSamples, bool enabled) noexcept;
+
+    // moves the messages up to (and including) samplePosition into the block's output,
+    // so they stay in time order with the notes being generated. The output has to keep
+    // room for getNumPending() of them: clock messages are never dropped.
+    void flushInto(MidiMerger& output, int samplePosition) noexcept;
+    int getNumPending() const noexcept { return numEvents - nextEvent; }
+
+    // sample position of the next message not yet flushed, or INT_MAX
+    int getNextPosition() const noexcept
+    {
+        return nextEvent < numEvents ? events[(size_t) nextEvent].samplePosition : std::numeric_limits<int>::max();
+    }
+
+    int getNumTicks() const noexcept { return numTicks; }
+    double getMaxErrorSamples() const noexcept { return maxErrorSamples; }   // how far a tick sat from its exact time
+
+    static bool isClockMessage(const juce::uint8* data, int numBytes) noexcept
+    {
+        return numBytes > 0 && (data[0] == 0xf8 || data[0] == 0xfa || data[0] == 0xfb || data[0] == 0xfc || data[0] == 0xf2);
+    }
+
+private:
+    void add(int samplePosition, juce::uint8 status, int songPosition = 0) noexcept;
+
+    struct Event
+    {
+        int samplePosition;
+        juce::uint8 size;
+        juce::uint8 data[3];
+    };
+
+    std::array<Event, maxEventsPerBlock> events;
+    int numEvents = 0, nextEvent = 0, numTicks = 0;
+    double maxErrorSamples = 0.0;
+
+    bool running = false;
+    juce::int64 nextTick = 0;       // the next tick to send, counted from the start of the song
+    double expectedTick = 0.0;      // where the playhead should be at the start of the next block
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MidiClock)
+};
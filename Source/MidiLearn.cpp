@@ -0,0 +1,164 @@
+/*
+  ==============================================================================
+
+    MidiLearn.cpp
+
+  ==============================================================================
+*/
+
+#include "MidiLearn.h"
+
+//==============================================================================
+MidiLearn::MidiLearn(juce::AudioProcessorValueTreeState& s, const juce::StringArray& ids)
+    : state(s), parameterIDs(ids)
+{
+    jassert(parameterIDs.size() <= maxTargets);
+
+    for (auto& id : parameterIDs)
+    {
+        auto* param = state.getParameter(id);
+        jassert(param != nullptr);
+        targets.add(param);
+    }
+
+    for (auto& p : pending)
+        p.store(-1, std::memory_order_relaxed);
+}
+
+MidiLearn::~MidiLearn()
+{
+    stopTimer();
+}
+
+//==============================================================================
+void MidiLearn::startLearning(const juce::String& paramID)
+{
+    learning.store(parameterIDs.indexOf(paramID), std::memory_order_release);
+    updateTimer();
+}
+
+bool MidiLearn::isLearning(const juce::String& paramID) const
+{
+    auto target = learning.load(std::memory_order_acquire);
+    return target >= 0 && target == parameterIDs.indexOf(paramID);
+}
+
+void MidiLearn::forget(const juce::String& paramID)
+{
+    auto target = parameterIDs.indexOf(paramID);
+
+    if (target < 0)
+        return;
+
+    map.update([target](Map& m)
+    {
+        for (auto& entry : m)
+            if (entry == target + 1)
+                entry = 0;
+    });
+
+    storeInState();
+    updateTimer();
+}
+
+juce::String MidiLearn::getAssignment(const juce::String& paramID) const
+{
+    auto target = parameterIDs.indexOf(paramID);
+    auto mappings = juce::StringArray::fromTokens(state.state.getProperty("midiLearn").toString(), false);
+
+    for (auto& m : mappings)
+        if (m.fromFirstOccurrenceOf("=", false, false) == paramID && target >= 0)
+            return "CC " + m.fromFirstOccurrenceOf(":", false, false).upToFirstOccurrenceOf("=", false, false)
+                 + ", ch " + juce::String(m.upToFirstOccurrenceOf(":", false, false).getIntValue() + 1);
+
+    return {};
+}
+
+//==============================================================================
+// One CC drives one target, so learning a CC that was already mapped moves it.
+void MidiLearn::setMapping(int channel, int number, int target)
+{
+    map.update([=](Map& m) { m[(size_t) (channel * 128 + number)] = (juce::uint8) (target + 1); });
+    storeInState();
+}
+
+// stored as "channel:cc=paramID" tokens, so the mappings survive reordering the targets
+void MidiLearn::storeInState()
+{
+    juce::StringArray mappings;
+
+    map.inspect([&](const Map& m)
+    {
+        for (int i = 0; i < 16 * 128; ++i)
+            if (auto entry = m[(size_t) i])
+                mappings.add(juce::String(i / 128) + ":" + juce::String(i % 128) + "=" + parameterIDs[entry - 1]);
+    });
+
+    state.state.setProperty("midiLearn", mappings.joinIntoString(" "), nullptr);
+}
+
+void MidiLearn::restoreFromState()
+{
+    auto mappings = juce::StringArray::fromTokens(state.state.getProperty("midiLearn").toString(), false);
+
+    map.update([&](Map& m)
+    {
+        m.fill(0);
+
+        for (auto& token : mappings)
+        {
+            auto channel = token.upToFirstOccurrenceOf(":", false, false).getIntValue();
+            auto number = token.fromFirstOccurrenceOf(":", false, false).upToFirstOccurrenceOf("=", false, false).getIntValue();
+            auto target = parameterIDs.indexOf(token.fromFirstOccurrenceOf("=", false, false));
+
+            if (juce::isPositiveAndBelow(channel, 16) && juce::isPositiveAndBelow(number, 128) && target >= 0)
+                m[(size_t) (channel * 128 + number)] = (juce::uint8) (target + 1);
+        }
+    });
+
+    updateTimer();
+}
+
+// The timer only has work while something is mapped, a CC is being learned, or a CC
+// value is still on its way to a parameter, so most instances never run it at all
+void MidiLearn::updateTimer()
+{
+    bool anyMapped = false;
+    map.inspect([&anyMapped](const Map& m) { anyMapped = std::any_of(m.begin(), m.end(), [](juce::uint8 e) { return e != 0; }); });
+
+    auto needed = anyMapped || learning.load(std::memory_order_acquire) >= 0 || learned.load(std::memory_order_acquire) >= 0
+               || std::any_of(pending.begin(), pending.end(), [](const std::atomic<int>& p) { return p.load(std::memory_order_acquire) >= 0; });
+
+    if (needed && !isTimerRunning())
+        startTimerHz(30);
+    else if (!needed && isTimerRunning())
+        stopTimer();
+}
+
+//==============================================================================
+void MidiLearn::timerCallback()
+{
+    auto l = learned.exchange(-1, std::memory_order_acq_rel);
+
+    if (l >= 0)
+        setMapping((l >> 8) & 0x0f, l & 0x7f, l >> 16);
+
+    // hand the CC values over to the parameters; the audio thread keeps using a CC value
+    // until its parameter has it, and a newer CC arriving meanwhile stays pending
+    for (int t = 0; t < targets.size(); ++t)
+    {
+        auto cc = pending[(size_t) t].load(std::memory_order_acquire);
+
+        if (cc < 0)
+            continue;
+
+        auto* param = targets.getUnchecked(t);
+        param->beginChangeGesture();
+        param->setValueNotifyingHost((float) cc / 127.0f);
+        param->endChangeGesture();
+
+        pending[(size_t) t].compare_exchange_strong(cc, -1, std::memory_order_acq_rel);
+    }
+
+    updateTimer();
+}
@@ -0,0 +1,114 @@
+/*
+  ==============================================================================
+
+    MidiLearn.h
+
+    Maps incoming controllers onto the arp's parameters. The channel x CC
+    table is published to the audio thread as a whole (see ConfigPublisher.h),
+    so each incoming CC is a single lookup. A mapped CC changes the value the
+    arp uses from its own sample position on; the parameter itself is
+    updated afterwards from the message thread so the host and the editor
+    follow along.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ConfigPublisher.h"
+
+//==============================================================================
+class MidiLearn : private juce::Timer
+{
+public:
+    // table entry: index of the target parameter + 1, 0 where nothing is mapped
+    using Map = std::array<juce::uint8, 16 * 128>;
+
+    // targets are looked up once here; their order is the index the audio thread uses
+    MidiLearn(juce::AudioProcessorValueTreeState& state, const juce::StringArray& parameterIDs);
+    ~MidiLearn() override;
+
+    //==============================================================================
+    // message thread
+    bool isLearnable(const juce::String& paramID) const { return parameterIDs.contains(paramID); }
+    void startLearning(const juce::String& paramID);
+    bool isLearning(const juce::String& paramID) const;
+    void forget(const juce::String& paramID);
+
+    // e.g. "CC 74, ch 1", or empty when nothing is mapped onto it
+    juce::String getAssignment(const juce::String& paramID) const;
+
+    // the mappings are kept as a property of the plugin state
+    void restoreFromState();
+
+    //==============================================================================
+    // audio thread
+    ConfigPublisher<Map>& getMap() noexcept { return map; }
+
+    int getNumTargets() const noexcept { return targets.size(); }
+
+    // the value the arp should use right now: a CC that hasn't reached the parameter yet wins
+    float getValue(int target) const noexcept
+    {
+        auto* param = targets.getUnchecked(target);
+        auto cc = pending[(size_t) target].load(std::memory_order_acquire);
+
+        return param->convertFrom0to1(cc >= 0 ? (float) cc / 127.0f : param->getValue());
+    }
+
+    // Returns the target the controller moved, after writing its new value into
+    // values[target], or -1 if it isn't mapped (or was just used for learning).
+    int handleController(const Map& table, const juce::uint8* data, float* values) noexcept
+    {
+        auto channel = data[0] & 0x0f;
+        auto number = data[1] & 0x7f;
+        auto value = data[2] & 0x7f;
+
+        if (learning.load(std::memory_order_relaxed) >= 0)
+        {
+            auto target = learning.exchange(-1, std::memory_order_acq_rel);
+
+            if (target >= 0)
+                learned.store((target << 16) | (channel << 8) | number, std::memory_order_release);
+
+            return -1;
+        }
+
+        auto target = (int) table[(size_t) (channel * 128 + number)] - 1;
+
+        if (target < 0)
+            return -1;
+
+        pending[(size_t) target].store(value, std::memory_order_release);
+        values[target] = targets.getUnchecked(target)->convertFrom0to1((float) value / 127.0f);
+        return target;
+    }
+
+    static bool isController(const juce::uint8* data, int numBytes) noexcept
+    {
+        return numBytes == 3 && (data[0] & 0xf0) == 0xb0;
+    }
+
+private:
+    void timerCallback() override;
+    void setMapping(int channel, int number, int target);
+    void storeInState();
+    void updateTimer();
+
+    static constexpr int maxTargets = 32;
+
+    juce::AudioProcessorValueTreeState& state;
+    const juce::StringArray parameterIDs;
+    juce::Array<juce::RangedAudioParameter*> targets;
+
+    ConfigPublisher<Map> map;
+
+    // last CC value (0-127) per target that the parameter hasn't caught up with, -1 if none
+    std::array<std::atomic<int>, maxTargets> pending;
+
+    std::atomic<int> learning{ -1 };    // target waiting for a CC
+    std::atomic<int> learned{ -1 };     // target << 16 | channel << 8 | CC, for the message thread
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MidiLearn)
+};
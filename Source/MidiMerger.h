@@ -0,0 +1,98 @@
+/*
+  ==============================================================================
+
+    MidiMerger.h
+
+    Builds a block's output in one linear pass: everything in the input that
+    isn't a note (CC, pitch bend, aftertouch, SysEx...) is forwarded untouched
+    at its original sample position, and the notes generated by the arp are
+    merged in between them.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+class MidiMerger
+{
+public:
+    static constexpr int maxGenerated = 128;    // notes plus up to MidiClock::maxEventsPerBlock clock messages
+
+    void clear() noexcept { numGenerated = 0; }
+    int size() const noexcept { return numGenerated; }
+    int getFreeSpace() const noexcept { return maxGenerated - numGenerated; }
+
+    // generated events have to be added in time order; returns false once the block is full
+    bool add(const juce::MidiMessage& m, int samplePosition) noexcept
+    {
+        jassert(numGenerated == 0 || events[(size_t) numGenerated - 1].samplePosition <= samplePosition);
+        jassert(m.getRawDataSize() <= 3);
+
+        if (numGenerated == maxGenerated)
+            return false;
+
+        auto& e = events[(size_t) numGenerated++];
+        e.samplePosition = samplePosition;
+        e.size = (juce::uint8) m.getRawDataSize();
+        std::memcpy(e.data, m.getRawData(), e.size);
+        return true;
+    }
+
+    void mergeInto(juce::MidiBuffer& dest, const juce::MidiBuffer& input) const noexcept
+    {
+        int next = 0;
+
+        for (const auto metadata : input)
+        {
+            if (isNoteEvent(metadata.data, metadata.numBytes))
+                continue;
+
+            // forwarded events go first when they share a sample with a generated one
+            for (; next < numGenerated && events[(size_t) next].samplePosition < metadata.samplePosition; ++next)
+                append(dest, events[(size_t) next].data, events[(size_t) next].size, events[(size_t) next].samplePosition);
+
+            append(dest, metadata.data, metadata.numBytes, metadata.samplePosition);
+        }
+
+        for (; next < numGenerated; ++next)
+            append(dest, events[(size_t) next].data, events[(size_t) next].size, events[(size_t) next].samplePosition);
+    }
+
+    static bool isNoteEvent(const juce::uint8* data, int numBytes) noexcept
+    {
+        auto status = data[0] & 0xf0;
+        return numBytes == 3 && (status == 0x80 || status == 0x90);
+    }
+
+    // MidiBuffer::addEvent() walks from the start of the buffer to find its
+    // insertion point, which goes quadratic with dense controller streams.
+    // Events that arrive in time order can go straight on the end, using the
+    // buffer's own packing (int32 sample position, uint16 size, bytes).
+    static void append(juce::MidiBuffer& dest, const juce::uint8* data, int numBytes, int samplePosition) noexcept
+    {
+        auto samplePos = (juce::int32) samplePosition;
+        auto size = (juce::uint16) numBytes;
+        auto start = dest.data.size();
+
+        dest.data.resize(start + (int) (sizeof(samplePos) + sizeof(size)) + numBytes);
+
+        auto* d = dest.data.getRawDataPointer() + start;
+        std::memcpy(d, &samplePos, sizeof(samplePos));
+        std::memcpy(d + sizeof(samplePos), &size, sizeof(size));
+        std::memcpy(d + sizeof(samplePos) + sizeof(size), data, (size_t) numBytes);
+    }
+
+private:
+    struct Event
+    {
+        int samplePosition;
+        juce::uint8 size;
+        juce::uint8 data[3];
+    };
+
+    std::array<Event, maxGenerated> events;
+    int numGenerated = 0;
+};
@@ -0,0 +1,126 @@
+/*
+  ==============================================================================
+
+    NoteDivisions.h
+
+    The step lengths the arp can lock to in sync mode. Every entry is an exact
+    length (num / den) in quarter notes, or for the bar lengths in bars of the
+    host's time signature, so "1 bar" is three quarters long in 3/4 and seven
+    eighths in 7/8. Turning one into samples is a multiply and a divide, and
+    StepLength only does even that when the tempo, time signature, sample
+    rate or one of the step parameters actually changes.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+namespace divisions
+{
+
+//==============================================================================
+struct Division
+{
+    const char* name;
+    int num, den;       // length in quarter notes, or in bars
+    bool bars = false;
+};
+
+// 4 bars down to 1/64, each as straight, dotted (x3/2), triplet (3 in the time of 2),
+// quintuplet (5 in the time of 4) and septuplet (7 in the time of 4)
+constexpr Division table[] =
+{
+    { "4 bars", 4, 1, true }, { "4 bars.", 6, 1, true }, { "4 bars T", 8, 3, true }, { "4 bars 5", 16, 5, true }, { "4 bars 7", 16, 7, true },
+    { "2 bars", 2, 1, true }, { "2 bars.", 3, 1, true }, { "2 bars T", 4, 3, true }, { "2 bars 5",  8, 5, true }, { "2 bars 7",  8, 7, true },
+    { "1 bar",  1, 1, true }, { "1 bar.",  3, 2, true }, { "1 bar T",  2, 3, true }, { "1 bar 5",   4, 5, true }, { "1 bar 7",   4, 7, true },
+    { "1/2",      2, 1 }, { "1/2.",      3, 1 }, { "1/2T",       4, 3 },  { "1/2 5",      8, 5 },  { "1/2 7",      8, 7 },
+    { "1/4",      1, 1 }, { "1/4.",      3, 2 }, { "1/4T",       2, 3 },  { "1/4 5",      4, 5 },  { "1/4 7",      4, 7 },
+    { "1/8",      1, 2 }, { "1/8.",      3, 4 }, { "1/8T",       1, 3 },  { "1/8 5",      2, 5 },  { "1/8 7",      2, 7 },
+    { "1/16",     1, 4 }, { "1/16.",     3, 8 }, { "1/16T",      1, 6 },  { "1/16 5",     1, 5 },  { "1/16 7",     1, 7 },
+    { "1/32",     1, 8 }, { "1/32.",    3, 16 }, { "1/32T",     1, 12 },  { "1/32 5",    1, 10 },  { "1/32 7",    1, 14 },
+    { "1/64",    1, 16 }, { "1/64.",    3, 32 }, { "1/64T",     1, 24 },  { "1/64 5",    1, 20 },  { "1/64 7",    1, 28 },
+};
+
+constexpr int numDivisions = (int) (sizeof(table) / sizeof(table[0]));
+constexpr int defaultDivision = 30;     // 1/16
+
+static_assert(table[defaultDivision].num == 1 && table[defaultDivision].den == 4 && !table[defaultDivision].bars,
+              "default should be a sixteenth");
+
+inline juce::StringArray getNames()
+{
+    juce::StringArray names;
+
+    for (const auto& d : table)
+        names.add(d.name);
+
+    return names;
+}
+
+//==============================================================================
+// Step length in samples, only recalculated when one of its inputs changes.
+class StepLength
+{
+public:
+    int get(double sampleRate, double bpm, int timeSigNumerator, int timeSigDenominator, bool synced, float speed,
+            int division, bool dotted, bool triplet) noexcept
+    {
+        if (sampleRate != lastSampleRate || bpm != lastBpm || timeSigNumerator != lastNumerator || timeSigDenominator != lastDenominator
+            || synced != lastSynced || speed != lastSpeed || division != lastDivision || dotted != lastDotted || triplet != lastTriplet)
+        {
+            lastSampleRate = sampleRate;
+            lastBpm = bpm;
+            lastNumerator = timeSigNumerator;
+            lastDenominator = timeSigDenominator;
+            lastSynced = synced;
+            lastSpeed = speed;
+            lastDivision = division;
+            lastDotted = dotted;
+            lastTriplet = triplet;
+
+            samples = calculate();
+        }
+
+        return samples;
+    }
+
+private:
+    int calculate() const noexcept
+    {
+        // dot and trip stretch whatever length is picked, still as an exact ratio
+        double num = 1.0, den = 1.0;
+
+        if (lastDotted) { num *= 3.0; den *= 2.0; }
+        if (lastTriplet) { num *= 2.0; den *= 3.0; }
+
+        double length;
+
+        if (lastSynced)
+        {
+            const auto& d = table[juce::jlimit(0, numDivisions - 1, lastDivision)];
+            auto samplesPerQuarter = lastSampleRate * 60.0 / (lastBpm > 0.0 ? lastBpm : 120.0);
+            length = samplesPerQuarter * d.num * num / (d.den * den);
+
+            // hosts that don't say (or say nonsense) get 4/4
+            if (d.bars)
+                length *= lastNumerator > 0 && lastDenominator > 0 ? 4.0 * lastNumerator / lastDenominator : 4.0;
+        }
+        else
+        {
+            length = lastSampleRate * 0.25 * (0.1 + (1.0 - lastSpeed)) * num / den;
+        }
+
+        return juce::jmax(1, juce::roundToInt(length));
+    }
+
+    double lastSampleRate = 0.0, lastBpm = 0.0;
+    int lastNumerator = 0, lastDenominator = 0;
+    float lastSpeed = -1.0f;
+    int lastDivision = -1;
+    bool lastSynced = false, lastDotted = false, lastTriplet = false;
+    int samples = 1;
+};
+
+} // namespace divisions
@@ -0,0 +1,94 @@
+/*
+  ==============================================================================
+
+    OnsetDetector.cpp
+
+  ==============================================================================
+*/
+
+#include "OnsetDetector.h"
+
+//==============================================================================
+void OnsetDetector::prepare(double sampleRate)
+{
+    auto chunksPerSecond = sampleRate / chunkSize;
+
+    // ~1 ms to follow a hit, ~150 ms for the background level, and at most one hit every 50 ms
+    fastCoeff = (float) (1.0 - std::exp(-1.0 / (0.001 * chunksPerSecond)));
+    slowCoeff = (float) (1.0 - std::exp(-1.0 / (0.150 * chunksPerSecond)));
+    holdoffChunks = juce::jmax(1, juce::roundToInt(0.050 * chunksPerSecond));
+
+    reset();
+}
+
+void OnsetDetector::reset() noexcept
+{
+    fast = slow = 0.0f;
+    holdoff = 0;
+    armed = true;
+}
+
+//==============================================================================
+int OnsetDetector::process(const juce::AudioBuffer<float>& audio, int numSamples, float sensitivity, int* onsets, int maxOnsets) noexcept
+{
+    if (audio.getNumChannels() == 0)
+        return 0;
+
+    // how far over the background level a hit has to go: x9 at 0, x1.5 at full sensitivity
+    auto ratio = 1.5f + 7.5f * (1.0f - juce::jlimit(0.0f, 1.0f, sensitivity));
+    int numOnsets = 0;
+
+    for (int start = 0; start < numSamples; start += chunkSize)
+    {
+        auto size = juce::jmin(chunkSize, numSamples - start);
+        auto peak = chunkPeak(audio, start, size);
+
+        fast += fastCoeff * (peak - fast);
+        slow += slowCoeff * (peak - slow);
+
+        auto threshold = juce::jmax(noiseFloor, slow * ratio);
+
+        if (holdoff > 0)
+            --holdoff;
+
+        // has to drop back under half the threshold before it can fire again
+        if (!armed && fast < threshold * 0.5f)
+            armed = true;
+
+        if (armed && holdoff == 0 && peak > threshold && fast > noiseFloor)
+        {
+            armed = false;
+            holdoff = holdoffChunks;
+
+            if (numOnsets < maxOnsets)
+                onsets[numOnsets++] = start + firstCrossing(audio, start, size, threshold);
+        }
+    }
+
+    return numOnsets;
+}
+
+float OnsetDetector::chunkPeak(const juce::AudioBuffer<float>& audio, int start, int size) const noexcept
+{
+    float peak = 0.0f;
+
+    for (int ch = 0; ch < audio.getNumChannels(); ++ch)
+    {
+        auto* samples = audio.getReadPointer(ch, start);
+
+        for (int i = 0; i < size; ++i)
+            peak = juce::jmax(peak, std::abs(samples[i]));
+    }
+
+    return peak;
+}
+
+int OnsetDetector::firstCrossing(const juce::AudioBuffer<float>& audio, int start, int size, float threshold) const noexcept
+{
+    for (int i = 0; i < size; ++i)
+        for (int ch = 0; ch < audio.getNumChannels(); ++ch)
+            if (std::abs(audio.getSample(ch, start + i)) > threshold)
+                return i;
+
+    return 0;
+}
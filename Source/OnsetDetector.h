@@ -0,0 +1,51 @@
+/*
+  ==============================================================================
+
+    OnsetDetector.h
+
+    Finds hits (drums, plucks...) in the sidechain input so the arp can step
+    on them instead of on its clock. The signal is looked at in 8-sample
+    chunks, and each chunk's peak feeds two one-pole envelopes. A hit is a
+    chunk peaking over the slow (~150 ms) envelope times a ratio set by the
+    sensitivity: the adaptive threshold. The fast (~1 ms) envelope doesn't
+    fire anything; it keeps noise under -60 dB out, and has to fall back
+    under half the threshold before the next hit can fire. A hit's position
+    is then pinned down to the first sample in the chunk over the threshold.
+
+    It's all scalar, one envelope update per chunk: at these sizes a plain
+    loop over 8 samples costs less than a call into the vector routines.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+class OnsetDetector
+{
+public:
+    void prepare(double sampleRate);
+    void reset() noexcept;
+
+    // audio thread: writes the sample offsets of the hits in this block, in order,
+    // and returns how many there were. sensitivity goes from 0 (only big hits) to 1.
+    int process(const juce::AudioBuffer<float>& audio, int numSamples, float sensitivity, int* onsets, int maxOnsets) noexcept;
+
+    static constexpr int maxOnsetsPerBlock = 64;
+
+private:
+    static constexpr int chunkSize = 8;
+    static constexpr float noiseFloor = 0.001f;     // -60 dB
+
+    float chunkPeak(const juce::AudioBuffer<float>& audio, int start, int size) const noexcept;
+    int firstCrossing(const juce::AudioBuffer<float>& audio, int start, int size, float threshold) const noexcept;
+
+    float fastCoeff = 1.0f, slowCoeff = 1.0f;
+    float fast = 0.0f, slow = 0.0f;
+    int holdoffChunks = 1, holdoff = 0;
+    bool armed = true;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(OnsetDetector)
+};
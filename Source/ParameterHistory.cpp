@@ -0,0 +1,117 @@
+/*
+  ==============================================================================
+
+    ParameterHistory.cpp
+
+  ==============================================================================
+*/
+
+#include "ParameterHistory.h"
+
+//==============================================================================
+ParameterHistory::ParameterHistory(const juce::Array<juce::AudioProcessorParameter*>& parameters)
+    : params(parameters), gestureStart((size_t) parameters.size(), 0.0f)
+{
+    jassert(params.size() <= 0xffff);
+
+    for (auto* p : params)
+        p->addListener(this);
+}
+
+ParameterHistory::~ParameterHistory()
+{
+    for (auto* p : params)
+        p->removeListener(this);
+}
+
+//==============================================================================
+bool ParameterHistory::undo()
+{
+    if (!canUndo())
+        return false;
+
+    --numUndoable;
+    ++numRedoable;
+
+    auto& edit = at(numUndoable);
+    apply(edit, edit.before);
+    return true;
+}
+
+bool ParameterHistory::redo()
+{
+    if (!canRedo())
+        return false;
+
+    auto& edit = at(numUndoable);
+    apply(edit, edit.after);
+
+    ++numUndoable;
+    --numRedoable;
+    return true;
+}
+
+void ParameterHistory::clear() noexcept
+{
+    oldest = numUndoable = numRedoable = 0;
+}
+
+//==============================================================================
+void ParameterHistory::parameterGestureChanged(int parameterIndex, bool gestureIsStarting)
+{
+    // our own undo/redo gestures, and anything not on the message thread, aren't edits
+    if (applying || !juce::MessageManager::existsAndIsCurrentThread()
+        || !juce::isPositiveAndBelow(parameterIndex, params.size()))
+        return;
+
+    auto value = params.getUnchecked(parameterIndex)->getValue();
+
+    if (gestureIsStarting)
+        gestureStart[(size_t) parameterIndex] = value;
+    else if (value != gestureStart[(size_t) parameterIndex])
+        record(parameterIndex, gestureStart[(size_t) parameterIndex], value);
+}
+
+void ParameterHistory::record(int parameterIndex, float before, float after)
+{
+    if (edits == nullptr)
+        edits.allocate((size_t) capacity, false);
+
+    auto now = juce::Time::getMillisecondCounter();
+    auto recent = now - lastRecordMs < coalesceMs;
+    lastRecordMs = now;
+
+    // more of the same edit: stretch the last one instead of adding another
+    if (recent && numRedoable == 0 && numUndoable > 0 && at(numUndoable - 1).parameter == parameterIndex)
+    {
+        auto& last = at(numUndoable - 1);
+        last.after = after;
+
+        if (last.after == last.before)
+            --numUndoable;
+
+        return;
+    }
+
+    numRedoable = 0;
+
+    if (numUndoable == capacity)
+        oldest = (oldest + 1) % capacity;
+    else
+        ++numUndoable;
+
+    at(numUndoable - 1) = { (juce::uint16) parameterIndex, before, after };
+}
+
+void ParameterHistory::apply(const Edit& edit, float value)
+{
+    const juce::ScopedValueSetter<bool> ignoreOwnGestures(applying, true);
+    auto* p = params[(int) edit.parameter];
+
+    // as a gesture, so a host writing automation picks it up
+    p->beginChangeGesture();
+    p->setValueNotifyingHost(value);
+    p->endChangeGesture();
+
+    lastRecordMs = 0;   // an edit after an undo never folds into the one before it
+}
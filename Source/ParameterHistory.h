@@ -0,0 +1,72 @@
+/*
+  ==============================================================================
+
+    ParameterHistory.h
+
+    Undo / redo for parameter edits. Each edit is kept as a delta (which
+    parameter, value before, value after) in a fixed-size ring, so the
+    history never grows: once it's full the oldest edit is forgotten. The
+    ring is only allocated on the first edit, so an instance nobody edits
+    by hand (most of a big session) doesn't carry it.
+
+    Edits are taken from the begin/endChangeGesture calls the editor's
+    controls (and MIDI learn) already make, so host automation, which
+    doesn't come with gestures, never lands in the history. A drag is one
+    gesture and so one edit, and further gestures on the same parameter
+    within coalesceMs are folded into it, so nudging an increment box or
+    turning a mapped knob comes back in a single undo.
+
+    Message thread only.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+class ParameterHistory : private juce::AudioProcessorParameter::Listener
+{
+public:
+    static constexpr int capacity = 2048;
+    static constexpr juce::uint32 coalesceMs = 400;
+
+    explicit ParameterHistory(const juce::Array<juce::AudioProcessorParameter*>& parameters);
+    ~ParameterHistory() override;
+
+    bool canUndo() const noexcept { return numUndoable > 0; }
+    bool canRedo() const noexcept { return numRedoable > 0; }
+
+    bool undo();
+    bool redo();
+    void clear() noexcept;
+
+    int getNumEdits() const noexcept { return numUndoable + numRedoable; }
+    size_t getMemoryUsage() const noexcept { return (size_t) getNumEdits() * sizeof(Edit); }
+    static constexpr size_t getMemoryLimit() noexcept { return capacity * sizeof(Edit); }
+
+private:
+    struct Edit
+    {
+        juce::uint16 parameter;
+        float before, after;
+    };
+
+    void parameterValueChanged(int, float) override {}
+    void parameterGestureChanged(int parameterIndex, bool gestureIsStarting) override;
+
+    void record(int parameterIndex, float before, float after);
+    void apply(const Edit& edit, float value);
+    Edit& at(int index) noexcept { return edits[(oldest + index) % capacity]; }
+
+    juce::Array<juce::AudioProcessorParameter*> params;
+    std::vector<float> gestureStart;    // value each parameter had when its current gesture began
+
+    juce::HeapBlock<Edit> edits;        // capacity edits, once there's been one
+    int oldest = 0, numUndoable = 0, numRedoable = 0;
+    juce::uint32 lastRecordMs = 0;
+    bool applying = false;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ParameterHistory)
+};
@@ -0,0 +1,144 @@
+/*
+  ==============================================================================
+
+    Pattern.cpp
+
+  ==============================================================================
+*/
+
+#include "Pattern.h"
+
+namespace pattern
+{
+
+//==============================================================================
+static bool isSeparator(juce::juce_wchar c)
+{
+    return juce::CharacterFunctions::isWhitespace(c) || c == '-';
+}
+
+static int readNumber(juce::String::CharPointerType& p)
+{
+    int value = 0;
+
+    while (p.isDigit() && value < 1000)
+        value = value * 10 + (int) (p.getAndAdvance() - '0');
+
+    return value;
+}
+
+juce::Result compile(const juce::String& source, Program& result)
+{
+    Program program;
+    auto p = source.getCharPointer();
+
+    for (;;)
+    {
+        while (!p.isEmpty() && isSeparator(*p))
+            ++p;
+
+        if (p.isEmpty())
+            break;
+
+        auto stepNumber = juce::String(program.length + 1);
+        Instruction ins{ Instruction::play, 0, 0 };
+        auto c = p.getAndAdvance();
+
+        if (juce::CharacterFunctions::isDigit(c))
+        {
+            --p;
+            auto n = readNumber(p);
+
+            if (n < 1 || n > 128)
+                return juce::Result::fail("Step " + stepNumber + ": note numbers go from 1 to 128");
+
+            ins.index = (juce::uint8) (n - 1);
+        }
+        else if (c == '>')  ins.op = Instruction::stepUp;
+        else if (c == '<')  ins.op = Instruction::stepDown;
+        else if (c == '?')  ins.op = Instruction::random;
+        else if (c == 'x' || c == 'X')  ins.op = Instruction::rest;
+        else
+            return juce::Result::fail("Step " + stepNumber + ": unexpected '" + juce::String::charToString(c) + "'");
+
+        if (*p == '(')
+        {
+            ++p;
+            auto sign = *p;
+
+            if (sign != '+' && sign != '-')
+                return juce::Result::fail("Step " + stepNumber + ": offsets look like (+12) or (-5)");
+
+            ++p;
+            auto amount = readNumber(p);
+
+            if (*p != ')')
+                return juce::Result::fail("Step " + stepNumber + ": missing ')'");
+
+            if (amount > maxTranspose)
+                return juce::Result::fail("Step " + stepNumber + ": offsets go up to " + juce::String(maxTranspose) + " semitones");
+
+            ++p;
+            ins.transpose = (juce::int8) (sign == '-' ? -amount : amount);
+        }
+
+        auto repeat = 1;
+
+        if (*p == '*')
+        {
+            ++p;
+            repeat = readNumber(p);
+
+            if (repeat < 1 || repeat > maxRepeat)
+                return juce::Result::fail("Step " + stepNumber + ": repeats go from 1 to " + juce::String(maxRepeat));
+        }
+
+        if (!p.isEmpty() && !isSeparator(*p))
+            return juce::Result::fail("Step " + stepNumber + ": unexpected '" + juce::String::charToString(*p) + "'");
+
+        if (program.length + repeat > maxInstructions)
+            return juce::Result::fail("Patterns can be up to " + juce::String(maxInstructions) + " steps long");
+
+        while (--repeat >= 0)
+            program.code[(size_t) program.length++] = ins;
+    }
+
+    result = program;
+    return juce::Result::ok();
+}
+
+//==============================================================================
+Machine::Step Machine::next(const juce::SortedSet<int>& notes) noexcept
+{
+    jassert(isLoaded());
+
+    if (pc >= program->length)
+        pc = 0;
+
+    const auto& ins = program->code[(size_t) pc];
+    pc = (pc + 1) % program->length;
+
+    auto size = notes.size();
+
+    if (size == 0 || ins.op == Instruction::rest)
+        return { -1, -1 };
+
+    // notes may have been released since the last step
+    index = juce::jmin(index, size - 1);
+
+    switch (ins.op)
+    {
+        case Instruction::play:      index = ins.index % size; break;
+        case Instruction::stepUp:    index = (index + 1) % size; break;
+        case Instruction::stepDown:  index = (index <= 0 ? size : index) - 1; break;
+        case Instruction::random:    index = juce::Random::getSystemRandom().nextInt(size); break;
+        case Instruction::rest:
+        case Instruction::numOps:
+        default:                     return { -1, -1 };
+    }
+
+    auto note = notes.getUnchecked(index) + ins.transpose;
+    return { juce::isPositiveAndBelow(note, 128) ? note : -1, index };
+}
+
+} // namespace pattern
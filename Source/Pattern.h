@@ -0,0 +1,114 @@
+/*
+  ==============================================================================
+
+    Pattern.h
+
+    User-written arp patterns. The text is compiled on the message thread
+    into a short, fixed-size program; the audio thread only ever runs that
+    program, one instruction per step, without allocating.
+
+    Steps are separated by spaces or '-', e.g. "1-3-2-4":
+
+        N       the Nth held note, counting up from the lowest (wraps round)
+        >  <    one held note up / down from the last one played
+        ?       a random held note
+        x       a rest
+
+    Any step can take a pitch offset in semitones and a repeat count:
+    "1(+12)", "3(-5)*2", "x*3".
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+namespace pattern
+{
+
+//==============================================================================
+struct Instruction
+{
+    enum Op : juce::uint8 { play, stepUp, stepDown, random, rest, numOps };
+
+    Op op;
+    juce::uint8 index;          // held-note index for play
+    juce::int8 transpose;       // semitones
+};
+
+constexpr int maxInstructions = 64;
+constexpr int maxTranspose = 48;
+constexpr int maxRepeat = 16;
+
+struct Program
+{
+    std::array<Instruction, maxInstructions> code{};
+    int length = 0;
+
+    bool isEmpty() const noexcept { return length == 0; }
+
+    // what compile() produces always passes; checked again when the audio thread picks it up
+    bool isValid() const noexcept
+    {
+        if (!juce::isPositiveAndNotGreaterThan(length, maxInstructions))
+            return false;
+
+        for (int i = 0; i < length; ++i)
+            if (code[(size_t) i].op >= Instruction::numOps || std::abs((int) code[(size_t) i].transpose) > maxTranspose)
+                return false;
+
+        return true;
+    }
+};
+
+// message thread: an empty or all-whitespace source gives an empty program
+juce::Result compile(const juce::String& source, Program& result);
+
+//==============================================================================
+// Runs a program on the audio thread, one instruction per step.
+class Machine
+{
+public:
+    struct Step
+    {
+        int note;       // -1 for a rest, or when the offset pushes the note out of range
+        int index;      // held-note index the step used, -1 for a rest
+    };
+
+    // once per block: the program has to stay alive until the block is done with it.
+    // A new version is checked (release builds too; one that fails plays as an empty
+    // pattern) and starts again from the first step.
+    void use(const Program& p, juce::uint32 version) noexcept
+    {
+        if (version != programVersion)
+        {
+            programVersion = version;
+            programIsValid = p.isValid();
+            jassert(programIsValid);
+            restart();
+        }
+
+        program = programIsValid ? &p : &emptyProgram;
+    }
+
+    bool isLoaded() const noexcept { return program != nullptr && !program->isEmpty(); }
+
+    void restart() noexcept
+    {
+        pc = 0;
+        index = -1;
+    }
+
+    Step next(const juce::SortedSet<int>& notes) noexcept;
+
+private:
+    static constexpr Program emptyProgram{};
+
+    const Program* program = nullptr;
+    juce::uint32 programVersion = 0;
+    bool programIsValid = true;
+    int pc = 0, index = -1;
+};
+
+} // namespace pattern
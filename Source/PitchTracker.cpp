@@ -0,0 +1,196 @@
+/*
+  ==============================================================================
+
+    PitchTracker.cpp
+
+  ==============================================================================
+*/
+
+#include "PitchTracker.h"
+
+//==============================================================================
+void PitchTracker::prepare(double sampleRate, int maximumBlockSize)
+{
+    decimation = juce::jmax(1, juce::roundToInt(sampleRate / 12000.0));
+    decimatedRate = sampleRate / decimation;
+
+    maxBlockSize = juce::jmax(1, maximumBlockSize);
+    mono.allocate((size_t) maxBlockSize, true);
+
+    reset();
+}
+
+void PitchTracker::reset() noexcept
+{
+    decimationCount = 0;
+    decimationSum = 0.0f;
+    filled = 0;
+    currentNote = candidate = -1;
+    candidateHops = silentHops = 0;
+}
+
+//==============================================================================
+int PitchTracker::process(const juce::AudioBuffer<float>& audio, int numSamples, NoteEvent* events, int maxEvents) noexcept
+{
+    auto numChannels = audio.getNumChannels();
+    int numEvents = 0;
+
+    if (numChannels == 0)
+        return 0;
+
+    // hosts aren't supposed to go over the prepared block size, but some do
+    for (int start = 0; start < numSamples; start += maxBlockSize)
+    {
+        auto size = juce::jmin(maxBlockSize, numSamples - start);
+
+        juce::FloatVectorOperations::copy(mono, audio.getReadPointer(0, start), size);
+
+        for (int ch = 1; ch < numChannels; ++ch)
+            juce::FloatVectorOperations::add(mono, audio.getReadPointer(ch, start), size);
+
+        if (numChannels > 1)
+            juce::FloatVectorOperations::multiply(mono, 1.0f / (float) numChannels, size);
+
+        for (int i = 0; i < size; ++i)
+        {
+            // boxcar decimation: crude, but the pitches we care about are far below the new Nyquist
+            decimationSum += mono[i];
+
+            if (++decimationCount < decimation)
+                continue;
+
+            frame[(size_t) filled++] = decimationSum / (float) decimation;
+            decimationSum = 0.0f;
+            decimationCount = 0;
+
+            if (filled == frameSize)
+            {
+                update(estimatePitch(), start + i, events, numEvents, maxEvents);
+
+                std::memmove(frame.data(), frame.data() + hopSize, sizeof(float) * (size_t) (frameSize - hopSize));
+                filled -= hopSize;
+            }
+        }
+    }
+
+    return numEvents;
+}
+
+//==============================================================================
+float PitchTracker::estimatePitch() noexcept
+{
+    const auto* x = frame.data();
+
+    // too quiet to say anything
+    float energy = 0.0f;
+
+    for (int j = 0; j < windowSize; ++j)
+        energy += x[j] * x[j];
+
+    if (energy < silenceRms * silenceRms * windowSize)
+        return 0.0f;
+
+    // YIN difference function. Four running sums so the compiler can keep them in one
+    // SIMD register (it won't reorder a single float sum by itself).
+    difference[0] = 0.0f;
+
+    for (int tau = 1; tau < maxLag; ++tau)
+    {
+        float sum[4] = {};
+
+        for (int j = 0; j < windowSize; j += 4)
+            for (int k = 0; k < 4; ++k)
+            {
+                auto d = x[j + k] - x[j + k + tau];
+                sum[k] += d * d;
+            }
+
+        difference[(size_t) tau] = (sum[0] + sum[1]) + (sum[2] + sum[3]);
+    }
+
+    // cumulative mean normalised difference, in place
+    float runningSum = 0.0f;
+    difference[0] = 1.0f;
+
+    for (int tau = 1; tau < maxLag; ++tau)
+    {
+        runningSum += difference[(size_t) tau];
+        difference[(size_t) tau] = runningSum > 0.0f ? difference[(size_t) tau] * (float) tau / runningSum : 1.0f;
+    }
+
+    // first dip under the threshold, followed down to its minimum
+    const int minLag = juce::jmax(2, (int) (decimatedRate / 2000.0));
+
+    for (int tau = minLag; tau < maxLag - 1; ++tau)
+    {
+        if (difference[(size_t) tau] >= yinThreshold)
+            continue;
+
+        while (tau + 1 < maxLag - 1 && difference[(size_t) tau + 1] < difference[(size_t) tau])
+            ++tau;
+
+        // parabolic interpolation between the neighbouring lags
+        auto a = difference[(size_t) tau - 1], b = difference[(size_t) tau], c = difference[(size_t) tau + 1];
+        auto denominator = a - 2.0f * b + c;
+        auto shift = std::abs(denominator) > 1.0e-9f ? 0.5f * (a - c) / denominator : 0.0f;
+
+        return (float) (decimatedRate / ((float) tau + juce::jlimit(-1.0f, 1.0f, shift)));
+    }
+
+    return 0.0f;
+}
+
+void PitchTracker::update(float frequency, int position, NoteEvent* events, int& numEvents, int maxEvents) noexcept
+{
+    auto add = [&](int note, bool isNoteOn)
+    {
+        if (numEvents < maxEvents)
+            events[numEvents++] = { position, note, isNoteOn };
+    };
+
+    if (frequency <= 0.0f)
+    {
+        candidate = -1;
+
+        // a few hops of nothing before letting go, so a breath or a consonant doesn't cut the note
+        if (currentNote >= 0 && ++silentHops >= 3)
+        {
+            add(currentNote, false);
+            currentNote = -1;
+        }
+
+        return;
+    }
+
+    silentHops = 0;
+
+    auto pitch = 69.0f + 12.0f * std::log2(frequency / 440.0f);
+    auto note = juce::roundToInt(pitch);
+
+    if (!juce::isPositiveAndBelow(note, 128))
+        return;
+
+    // hysteresis: stay on the current note until the pitch is well into the next one
+    if (currentNote >= 0 && std::abs(pitch - (float) currentNote) < 0.8f)
+    {
+        candidate = -1;
+        return;
+    }
+
+    if (note != candidate)
+    {
+        candidate = note;
+        candidateHops = 1;
+        return;
+    }
+
+    if (++candidateHops < 2)
+        return;
+
+    if (currentNote >= 0)
+        add(currentNote, false);
+
+    add(note, true);
+    currentNote = note;
+    candidate = -1;
+}
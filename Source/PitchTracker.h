@@ -0,0 +1,69 @@
+/*
+  ==============================================================================
+
+    PitchTracker.h
+
+    Turns a monophonic line on the sidechain (voice, bass, a lead...) into
+    held notes for the arp. The input is mixed to mono, decimated to about
+    12 kHz, and every hop (~5 ms) a YIN pitch estimate runs over the last
+    ~43 ms, which reaches down to about 47 Hz. Notes only change when a new
+    pitch has held for two hops and is most of a semitone away from the
+    current one, so vibrato and scoops don't make it chatter.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+class PitchTracker
+{
+public:
+    struct NoteEvent
+    {
+        int position;       // sample offset in the block
+        int note;
+        bool isNoteOn;
+    };
+
+    static constexpr int maxEventsPerBlock = 32;
+
+    void prepare(double sampleRate, int maximumBlockSize);
+    void reset() noexcept;
+
+    // audio thread: no allocation. Writes the note changes in this block, in order.
+    int process(const juce::AudioBuffer<float>& audio, int numSamples, NoteEvent* events, int maxEvents) noexcept;
+
+    // note currently held by the tracker, -1 if none
+    int getCurrentNote() const noexcept { return currentNote; }
+
+private:
+    // sizes at the decimated rate
+    static constexpr int windowSize = 256;
+    static constexpr int maxLag = 256;
+    static constexpr int hopSize = 64;
+    static constexpr int frameSize = windowSize + maxLag;
+
+    static constexpr float yinThreshold = 0.15f;
+    static constexpr float silenceRms = 0.003f;
+
+    float estimatePitch() noexcept;       // Hz, or 0 if there's no clear pitch
+    void update(float frequency, int position, NoteEvent* events, int& numEvents, int maxEvents) noexcept;
+
+    juce::HeapBlock<float> mono;
+    int maxBlockSize = 0;
+
+    double decimatedRate = 12000.0;
+    int decimation = 4, decimationCount = 0;
+    float decimationSum = 0.0f;
+
+    std::array<float, frameSize> frame{};
+    std::array<float, maxLag> difference{};
+    int filled = 0;
+
+    int currentNote = -1, candidate = -1, candidateHops = 0, silentHops = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PitchTracker)
+};
@@ -9,11 +9,90 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
 
+//=======================================================================================
+// Timer-driven refreshes skip their work while nobody can see the result: false when
+// the editor is minimised, hidden or detached from its window, and (JUCE 7 peers
+// report window occlusion) when the window is completely covered.
+static bool isOnScreen(const juce::Component& c)
+{
+    if (!c.isShowing())
+        return false;
+
+#if JUCE_MAJOR_VERSION >= 7
+    if (auto* peer = c.getPeer())
+        return peer->isShowing();
+#endif
+
+    return true;
+}
+
+//=======================================================================================
+// Base for everything in the editor that refreshes itself from a timer. While the editor
+// can't be seen it suspends all of them, so a hidden editor runs one slow visibility
+// check instead of a timer per control. startTimer() and friends remember the interval
+// asked for, and the timer picks up at that rate when the editor is back.
+class RefreshTimer : protected juce::Timer
+{
+public:
+    void suspendRefresh()
+    {
+        suspended = true;
+        juce::Timer::stopTimer();
+        refreshSuspended(true);
+    }
+
+    void resumeRefresh()
+    {
+        suspended = false;
+        refreshSuspended(false);
+
+        if (interval > 0)
+            juce::Timer::startTimer(interval);
+    }
+
+protected:
+    void startTimer(int milliseconds)
+    {
+        interval = milliseconds;
+
+        if (!suspended)
+            juce::Timer::startTimer(milliseconds);
+    }
+
+    void startTimerHz(int hz) { startTimer(hz > 0 ? juce::jmax(1, 1000 / hz) : 0); }
+
+    void stopTimer()
+    {
+        interval = 0;
+        juce::Timer::stopTimer();
+    }
+
+    // for anything else that should stop along with the timer
+    virtual void refreshSuspended(bool /*isSuspended*/) {}
+
+private:
+    int interval = 0;
+    bool suspended = false;
+};
+
+static void setRefreshSuspended(juce::Component& c, bool shouldBeSuspended)
+{
+    if (auto* r = dynamic_cast<RefreshTimer*>(&c))
+    {
+        if (shouldBeSuspended)
+            r->suspendRefresh();
+        else
+            r->resumeRefresh();
+    }
+
+    for (auto* child : c.getChildren())
+        setRefreshSuspended(*child, shouldBeSuspended);
+}
 
 //=======================================================================================
 class ParameterListener : private juce::AudioProcessorParameter::Listener,
     private juce::AudioProcessorListener,
-    private juce::Timer
+    public RefreshTimer
 {
 public:
     ParameterListener(juce::AudioProcessor& proc, juce::AudioProcessorParameter& param)
@@ -63,6 +142,10 @@ private:
     //==============================================================================
     void timerCallback() override
     {
+        AARROW_TRACE_ZONE("ParameterListener::timerCallback");
+
+        // (while the editor is hidden this doesn't run at all; the change flag stays set,
+        //  so the control catches up as soon as it's back)
         if (parameterValueHasChanged.compareAndSetBool(0, 1))
         {
             handleNewParameterValue();
@@ -84,7 +167,7 @@ private:
 
 //============================================================================================================
 class SliderParameterComponent final : public juce::Component,
-    private ParameterListener
+    public ParameterListener
 {
 public:
     SliderParameterComponent(juce::AudioProcessor& proc, juce::AudioProcessorParameter& param)
@@ -135,51 +218,19 @@ public:
         link = &l;
     }
 
-    void linkAction()
+    // with BPM Link on the step length comes from the Division parameter, so the
+    // slider just greys out; its value is left alone for when sync goes off again
+    void linkAction(bool linked)
     {
-        if (slider.getSkewFactor() == 1.0f)
-        {
-            slider.setRange(0.9f, .94f);
-            slider.setSkewFactor(0.5f);
-            slider.setValue(0.92f);
-            bpm = true;
-        }
-        else
-        {
-            slider.setRange(0.0f, 1.0f);
-            slider.setSkewFactor(1.0f);
-            slider.setValue(0.5f);
-            bpm = false;
-        }
-
-        sliderValueChanged();
-        handleNewParameterValue();
-        updateTextDisplay();
+        slider.setEnabled(!linked);
+        valueLabel.setEnabled(!linked);
     }
 
 
 private:
     void updateTextDisplay()
     {
-        if (!bpm)
-        {
-            valueLabel.setText(getParameter().getCurrentValueAsText(), juce::dontSendNotification);
-        }
-        else
-        {
-            f = ceil(getParameter().getValue() * 100);
-
-            switch (f)
-            {
-            case 90: valueLabel.setText("1", juce::dontSendNotification); break;
-            case 91: valueLabel.setText("1/2", juce::dontSendNotification); break;
-            case 92: valueLabel.setText("1/4", juce::dontSendNotification); break;
-            case 93: valueLabel.setText("1/8", juce::dontSendNotification); break;
-            case 94: valueLabel.setText("1/16", juce::dontSendNotification); break;
-            default:  valueLabel.setText(juce::String(f), juce::dontSendNotification); break;
-            }
-
-        }
+        valueLabel.setText(getParameter().getCurrentValueAsText(), juce::dontSendNotification);
     }
 
     void handleNewParameterValue() override
@@ -224,8 +275,6 @@ private:
     juce::Component* link;
     juce::Label valueLabel;
     bool isDragging = false;
-    bool bpm = false;
-    int f;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SliderParameterComponent)
 };
@@ -233,7 +282,7 @@ private:
 //================================================================================================================
 
 class BooleanButtonParameterComponent final : public juce::Component,
-    private ParameterListener
+    public ParameterListener
 {
 public:
     BooleanButtonParameterComponent(juce::AudioProcessor& proc, juce::AudioProcessorParameter& param, juce::String buttonName)
@@ -261,6 +310,7 @@ public:
     void setLink(juce::Component& l)
     {
         link = &l;
+        updateLink();
     }
 
     void linkAction()
@@ -268,9 +318,18 @@ public:
     }
 
 private:
+    // runs whenever the parameter changes, however it changed (click, automation,
+    // a learned CC, undo, loading a preset), so the linked control always matches it
     void handleNewParameterValue() override
     {
         button.setToggleState(isParameterOn(), juce::dontSendNotification);
+        updateLink();
+    }
+
+    void updateLink()
+    {
+        if (auto* slider = dynamic_cast<SliderParameterComponent*>(link))
+            slider->linkAction(isParameterOn());
     }
 
 
@@ -281,10 +340,7 @@ private:
             getParameter().beginChangeGesture();
             getParameter().setValueNotifyingHost(button.getToggleState() ? 1.0f : 0.0f);
             getParameter().endChangeGesture();
-            if (link)
-                dynamic_cast<SliderParameterComponent*>(link)->linkAction();
-
-
+            updateLink();
         }
     }
 
@@ -296,7 +352,7 @@ private:
 };
 //==============================================================================
 class BooleanParameterComponent final : public juce::Component,
-    private ParameterListener
+    public ParameterListener
 {
 public:
     BooleanParameterComponent(juce::AudioProcessor& proc, juce::AudioProcessorParameter& param, juce::String buttonName)
@@ -356,7 +412,7 @@ private:
 };
 //==============================================================================
 class SwitchParameterComponent final : public juce::Component,
-    private ParameterListener
+    public ParameterListener
 {
 public:
     SwitchParameterComponent(juce::AudioProcessor& proc, juce::AudioProcessorParameter& param)
@@ -504,7 +560,7 @@ private:
 };
 //==============================================================================
 class IncrementParameterComponent final : public juce::Component,
-    private ParameterListener
+    public ParameterListener
 {
 public:
     IncrementParameterComponent(juce::AudioProcessor& proc, juce::AudioProcessorParameter& param)
@@ -612,7 +668,7 @@ private:
 //
 //==============================================================================
 class ChoiceParameterComponent final : public juce::Component,
-    private ParameterListener
+    public ParameterListener
 {
 public:
     ChoiceParameterComponent(juce::AudioProcessor& proc, juce::AudioProcessorParameter& param)
@@ -635,7 +691,7 @@ public:
     {
         auto area = getLocalBounds();
         area.removeFromLeft(8);
-        box.setBounds(area.reduced(0, 0)); // (0,10)
+        box.setBounds(area.reduced(0, 8)); // (0,10)
     }
 
     void setLink(juce::Component& l)
@@ -699,11 +755,13 @@ public:
 
         const juce::Array<juce::AudioProcessorParameter*>& p = processor.getParameters();
         // substring removes first char indicator (for switch component, circular/horizontal slider etc)
-        if (!parameter.isBoolean() && parameter.getAllValueStrings().size() < 2)
+        if (!parameter.isBoolean() && (parameter.getAllValueStrings().size() < 2 || parameter.getName(128).startsWithChar('c')))
             parameterName.setText(parameter.getName(128).substring(1), juce::dontSendNotification);
         parameterName.setJustificationType(juce::Justification::centredRight);
+        parameterName.setBufferedToImage(true);
         addAndMakeVisible(parameterName);
 
+        parameterLabel.setBufferedToImage(true);
         parameterLabel.setText(parameter.getLabel(), juce::dontSendNotification);
         addAndMakeVisible(parameterLabel);
 
@@ -716,10 +774,21 @@ public:
         //setSize(400, 40);
         setSize(paramWidth, 40);
 
+        // right-click anywhere on the row for MIDI learn
+        if (auto* arp = dynamic_cast<NewProjectAudioProcessor*>(&processor))
+            if (auto* withID = dynamic_cast<juce::AudioProcessorParameterWithID*>(&parameter))
+                if (arp->getMidiLearn().isLearnable(withID->paramID))
+                {
+                    learnClicks.midiLearn = &arp->getMidiLearn();
+                    learnClicks.paramID = withID->paramID;
+                    addMouseListener(&learnClicks, true);
+                }
     }
 
     ~ParameterDisplayComponent() override
-    {}
+    {
+        removeMouseListener(&learnClicks);
+    }
 
     void paint(juce::Graphics&) override {}
 
@@ -770,6 +839,37 @@ private:
     int paramWidth;
     std::unique_ptr<Component> parameterComp;
 
+    // separate from the component so clicks on it and on its children arrive once each
+    struct LearnClickListener : public juce::MouseListener
+    {
+        void mouseDown(const juce::MouseEvent& e) override
+        {
+            if (!e.mods.isPopupMenu())
+                return;
+
+            auto assignment = midiLearn->getAssignment(paramID);
+
+            juce::PopupMenu menu;
+            menu.addItem(1, "MIDI learn", true, midiLearn->isLearning(paramID));
+            menu.addItem(2, assignment.isEmpty() ? juce::String("Forget MIDI CC") : "Forget " + assignment, assignment.isNotEmpty());
+
+            // midiLearn belongs to the processor, which outlives the editor
+            menu.showMenuAsync(juce::PopupMenu::Options().withTargetComponent(e.eventComponent),
+                [ml = midiLearn, id = paramID](int result)
+                {
+                    if (result == 1)
+                        ml->startLearning(id);
+                    else if (result == 2)
+                        ml->forget(id);
+                });
+        }
+
+        MidiLearn* midiLearn = nullptr;
+        juce::String paramID;
+    };
+
+    LearnClickListener learnClicks;
+
     std::unique_ptr<Component> createParameterComp(juce::AudioProcessor& processor) const
     {
 
@@ -784,6 +884,10 @@ private:
             else
                 return std::make_unique<BooleanParameterComponent>(processor, parameter, parameter.getName(128));
 
+        // 'c' marks a long list of choices that gets a drop-down instead of a row of buttons
+        if (parameter.getName(128).startsWithChar('c'))
+            return std::make_unique<ChoiceParameterComponent>(processor, parameter);
+
         // Most hosts display any parameter with just two steps as a switch.
         if (parameter.getNumSteps() == 2)
             return std::make_unique<SwitchParameterComponent>(processor, parameter);
@@ -822,10 +926,10 @@ public:
             if (param->isAutomatable())
                 addChildAndSetID(paramComponents.add(new ParameterDisplayComponent(processor, *param, paramWidth)), param->getName(128) + "Comp");
 
-        //allComponents.addArray(paramComponents);   this line causes exception error... idk why but it's not being deleted properly
-        for (auto* param : parameters)    // have to do the loop again as a fix... still looking for a cleaner solution 
-            if (param->isAutomatable())
-                allComponents.add(new ParameterDisplayComponent(processor, *param, paramWidth));
+        // allComponents doesn't own anything (paramComponents and subPanels do), so the
+        // controls are listed here rather than built a second time
+        for (auto* comp : paramComponents)
+            allComponents.add(comp);
 
         maxWidth = 400;
         height = 0;
@@ -843,22 +947,26 @@ public:
         }
         setSize(maxWidth, juce::jmax(height, 40));
 
+        // fills its whole area, so nothing behind it needs repainting
+        setOpaque(true);
     }
 
     ~ParametersPanel() override
     {
         allComponents.clear();
         paramComponents.clear();
-
+        subPanels.clear();
     }
 
     void addComponent(ParameterDisplayComponent* comp, juce::String ID)
     {
         addChildAndSetID(paramComponents.add(comp), ID);
+        allComponents.add(comp);
     }
 
     void paint(juce::Graphics& g) override
     {
+        AARROW_TRACE_ZONE("ParametersPanel::paint");
         g.fillAll(getLookAndFeel().findColour(juce::ResizableWindow::backgroundColourId));
     }
 
@@ -888,6 +996,7 @@ public:
 
     void addPanel(ParametersPanel* p)
     {
+        subPanels.add(p);
         allComponents.add(p);
         addAndMakeVisible(p);
         setSize(maxWidth, getHeight() + p->getHeight());
@@ -902,7 +1011,8 @@ public:
     int paramWidth = 400;
     int paramHeight = 40;
     juce::OwnedArray<ParameterDisplayComponent> paramComponents;
-    juce::OwnedArray<Component> allComponents;
+    juce::OwnedArray<ParametersPanel> subPanels;
+    juce::Array<Component*> allComponents;
 
 private:
     bool horizontal;
@@ -911,6 +1021,565 @@ private:
 
 //==============================================================================>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
 
+//==============================================================================
+// Held notes in the order the arp walks them, the step that just played and the
+// one most likely to come next. Events come from the processor's FIFO at display
+// rate; only cells whose contents changed are repainted, over a background that
+// is rendered once per resize.
+class StepVisualizer : public juce::Component,
+    public RefreshTimer
+{
+public:
+    StepVisualizer(StepEventFifo& f) : fifo(f)
+    {
+        setOpaque(true);
+        shown.fill(-1);
+        fifo.setActive(true);
+        startTimerHz(30);
+    }
+
+    ~StepVisualizer() override
+    {
+        fifo.setActive(false);
+    }
+
+    void resized() override
+    {
+        background = {};
+    }
+
+    void paint(juce::Graphics& g) override
+    {
+        AARROW_TRACE_ZONE("StepVisualizer::paint");
+
+        if (background.isNull())
+            renderBackground();
+
+        g.drawImageAt(background, 0, 0);
+
+        for (int i = 0; i < numCells; ++i)
+            if (g.clipRegionIntersects(cellBounds(i)))
+                paintCell(g, i);
+    }
+
+private:
+    static constexpr int numCells = 32;
+    static constexpr int cellsPerRow = 16;
+
+    enum Highlight { none, upcoming, current };
+
+    juce::Rectangle<int> cellBounds(int i) const
+    {
+        auto w = getWidth() / cellsPerRow;
+        auto h = getHeight() / (numCells / cellsPerRow);
+        return { (i % cellsPerRow) * w, (i / cellsPerRow) * h, w, h };
+    }
+
+    int cellState(int i) const
+    {
+        if (i >= heldNotes.size())
+            return -1;
+
+        auto highlight = (i == currentIndex) ? current : (i == upcomingIndex) ? upcoming : none;
+        return heldNotes[i] * 4 + highlight;
+    }
+
+    void renderBackground()
+    {
+        background = juce::Image(juce::Image::RGB, juce::jmax(1, getWidth()), juce::jmax(1, getHeight()), true);
+        juce::Graphics g(background);
+
+        g.fillAll(getLookAndFeel().findColour(juce::ResizableWindow::backgroundColourId).darker(0.3f));
+        g.setColour(juce::Colours::white.withAlpha(0.08f));
+
+        for (int i = 0; i < numCells; ++i)
+            g.drawRect(cellBounds(i).reduced(1));
+    }
+
+    void paintCell(juce::Graphics& g, int i)
+    {
+        auto state = cellState(i);
+
+        if (state < 0)
+            return;
+
+        auto area = cellBounds(i).reduced(2).toFloat();
+
+        switch (state % 4)
+        {
+        case current:  g.setColour(juce::Colours::orange); g.fillRoundedRectangle(area, 3.0f); break;
+        case upcoming: g.setColour(juce::Colours::cyan); g.drawRoundedRectangle(area, 3.0f, 1.5f); break;
+        default:       g.setColour(juce::Colours::white.withAlpha(0.15f)); g.fillRoundedRectangle(area, 3.0f); break;
+        }
+
+        g.setColour(state % 4 == current ? juce::Colours::black : juce::Colours::white);
+        g.setFont(10.0f);
+        g.drawFittedText(juce::MidiMessage::getMidiNoteName(state / 4, true, true, 4), area.toNearestInt(), juce::Justification::centred, 1);
+    }
+
+    // suspended along with the rest of the editor: the audio thread stops publishing too
+    void refreshSuspended(bool isSuspended) override
+    {
+        fifo.setActive(!isSuspended);
+    }
+
+    void applyHeldNotes(const StepEventFifo::Event& e)
+    {
+        heldNotes.clearQuick();
+
+        for (int n = 0; n < 128; ++n)
+            if ((e.held[n >> 6] >> (n & 63)) & 1)
+                heldNotes.add(n);
+    }
+
+    void timerCallback() override
+    {
+        AARROW_TRACE_ZONE("StepVisualizer::timerCallback");
+
+        // while hidden the audio thread stops publishing altogether; whatever
+        // is still queued is drained below so the view is current when it comes back
+        auto visible = isOnScreen(*this);
+        fifo.setActive(visible);
+
+        StepEventFifo::Event events[64];
+        int numEvents;
+
+        while ((numEvents = fifo.pop(events, 64)) > 0)
+        {
+            for (int i = 0; i < numEvents; ++i)
+            {
+                const auto& e = events[i];
+                applyHeldNotes(e);
+
+                if (e.kind == StepEventFifo::Event::step)
+                {
+                    if (e.index >= 0 && currentIndex >= 0 && e.index != currentIndex)
+                        stepDirection = (e.index > currentIndex) ? 1 : -1;
+
+                    currentIndex = e.index;
+                }
+            }
+        }
+
+        if (currentIndex >= heldNotes.size())
+            currentIndex = -1;
+
+        upcomingIndex = (heldNotes.isEmpty() || currentIndex < 0) ? -1
+            : (currentIndex + stepDirection + heldNotes.size()) % heldNotes.size();
+
+        if (!visible)
+            return;
+
+        for (int i = 0; i < numCells; ++i)
+        {
+            auto state = cellState(i);
+
+            if (state != shown[(size_t) i])
+            {
+                shown[(size_t) i] = state;
+                repaint(cellBounds(i));
+            }
+        }
+    }
+
+    StepEventFifo& fifo;
+    juce::Image background;
+    juce::Array<int> heldNotes;
+    int currentIndex = -1, upcomingIndex = -1, stepDirection = 1;
+    std::array<int, numCells> shown;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(StepVisualizer)
+};
+
+//==============================================================================
+// Record / export strip for the MIDI capture. The "drag" label can be dragged
+// straight into a DAW track or the desktop.
+class CaptureStrip : public juce::Component,
+    public RefreshTimer
+{
+public:
+    CaptureStrip(MidiCapture& c) : capture(c)
+    {
+        recordButton.setClickingTogglesState(true);
+        recordButton.setToggleState(capture.isRecording(), juce::dontSendNotification);
+        recordButton.onClick = [this] { capture.setRecording(recordButton.getToggleState()); };
+        addAndMakeVisible(recordButton);
+
+        clearButton.onClick = [this] { capture.clear(); };
+        addAndMakeVisible(clearButton);
+
+        exportButton.onClick = [this] { exportToFile(); };
+        addAndMakeVisible(exportButton);
+
+        dragLabel.setJustificationType(juce::Justification::centred);
+        dragLabel.setInterceptsMouseClicks(false, false);
+        addAndMakeVisible(dragLabel);
+
+        startTimerHz(2);
+    }
+
+    void paint(juce::Graphics&) override {}
+
+    void resized() override
+    {
+        auto area = getLocalBounds().reduced(4, 2);
+        auto w = area.getWidth() / 4;
+
+        recordButton.setBounds(area.removeFromLeft(w));
+        clearButton.setBounds(area.removeFromLeft(w));
+        exportButton.setBounds(area.removeFromLeft(w));
+        dragLabel.setBounds(area);
+    }
+
+    void mouseDrag(const juce::MouseEvent& e) override
+    {
+        if (dragStarted || !dragLabel.getBounds().contains(e.getMouseDownPosition()))
+            return;
+
+        auto file = juce::File::getSpecialLocation(juce::File::tempDirectory).getChildFile("Arpeggiator capture.mid");
+
+        if (capture.writeToFile(file))
+        {
+            dragStarted = true;
+            juce::DragAndDropContainer::performExternalDragDropOfFiles(juce::StringArray(file.getFullPathName()), false, this,
+                [this] { dragStarted = false; });
+        }
+    }
+
+private:
+    void timerCallback() override
+    {
+        AARROW_TRACE_ZONE("CaptureStrip::timerCallback");
+
+        if (!isOnScreen(*this))
+            return;
+
+        auto n = capture.getNumCapturedEvents();
+        auto text = "drag " + juce::String(n) + " events";
+
+        if (auto d = capture.getNumDroppedEvents())
+            text << " (" << d << " dropped)";
+
+        dragLabel.setText(text, juce::dontSendNotification);
+    }
+
+    void exportToFile()
+    {
+        chooser = std::make_unique<juce::FileChooser>("Export captured MIDI",
+            juce::File::getSpecialLocation(juce::File::userDocumentsDirectory).getChildFile("Arpeggiator capture.mid"), "*.mid");
+
+        chooser->launchAsync(juce::FileBrowserComponent::saveMode | juce::FileBrowserComponent::canSelectFiles,
+            [this](const juce::FileChooser& fc)
+            {
+                auto file = fc.getResult();
+                if (file != juce::File())
+                    capture.writeToFile(file.withFileExtension("mid"));
+            });
+    }
+
+    MidiCapture& capture;
+    juce::TextButton recordButton{ "Rec" }, clearButton{ "Clear" }, exportButton{ "Export" };
+    juce::Label dragLabel;
+    std::unique_ptr<juce::FileChooser> chooser;
+    bool dragStarted = false;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(CaptureStrip)
+};
+
+//==============================================================================
+// Text box for the settings that are typed rather than dialled in: the pattern
+// played by the "Pattern" direction (see Pattern.h for the syntax) and the map
+// for the "Custom" groove (Groove.h). The text is applied when you press return
+// or click away; if it doesn't parse, the processor keeps playing the last good one.
+class SourceStrip : public juce::Component
+{
+public:
+    using Apply = std::function<juce::Result(const juce::String&)>;
+
+    SourceStrip(const juce::String& text, const juce::String& hint, Apply applyFunction)
+        : applySource(std::move(applyFunction))
+    {
+        editor.setText(text, false);
+        editor.setTextToShowWhenEmpty(hint, juce::Colours::grey);
+        editor.onReturnKey = [this] { apply(); };
+        editor.onFocusLost = [this] { apply(); };
+        addAndMakeVisible(editor);
+
+        status.setJustificationType(juce::Justification::centredLeft);
+        addAndMakeVisible(status);
+    }
+
+    void paint(juce::Graphics&) override {}
+
+    void resized() override
+    {
+        auto area = getLocalBounds().reduced(4, 2);
+
+        status.setBounds(area.removeFromRight(area.getWidth() / 3));
+        editor.setBounds(area);
+    }
+
+private:
+    void apply()
+    {
+        auto result = applySource(editor.getText());
+
+        status.setColour(juce::Label::textColourId, result.wasOk() ? juce::Colours::cyan : juce::Colours::red);
+        status.setText(result.wasOk() ? juce::String() : result.getErrorMessage(), juce::dontSendNotification);
+        status.setTooltip(status.getText());
+    }
+
+    Apply applySource;
+    juce::TextEditor editor;
+    juce::Label status;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SourceStrip)
+};
+
+//==============================================================================
+// The steps the current rhythm plays, one cell each. Clicking a cell toggles it
+// in the drawn mask; clicking while Euclidean (or Off) is selected starts the
+// mask from what's showing and switches to it.
+class RhythmStrip : public juce::Component,
+    public RefreshTimer
+{
+public:
+    RhythmStrip(NewProjectAudioProcessor& p) : processor(p)
+    {
+        startTimerHz(4);
+    }
+
+    void paint(juce::Graphics& g) override
+    {
+        auto area = getLocalBounds().reduced(4, 3).toFloat();
+        auto cell = area.getWidth() / (float) rhythm::maxSteps;
+
+        for (int i = 0; i < steps; ++i)
+        {
+            auto r = juce::Rectangle<float>(area.getX() + i * cell, area.getY(), cell, area.getHeight()).reduced(1.0f, 0.0f);
+
+            g.setColour(((shown >> i) & 1) ? juce::Colours::cyan : juce::Colours::darkgrey);
+            g.fillRect(r);
+
+            if (i % 4 == 0)
+            {
+                g.setColour(juce::Colours::grey);
+                g.fillRect(r.withWidth(1.0f).translated(-1.0f, 0.0f));
+            }
+        }
+    }
+
+    void mouseDown(const juce::MouseEvent& e) override
+    {
+        auto area = getLocalBounds().reduced(4, 3);
+        auto i = (e.x - area.getX()) * rhythm::maxSteps / juce::jmax(1, area.getWidth());
+
+        if (!juce::isPositiveAndBelow(i, steps))
+            return;
+
+        auto* mode = processor.rhythmMode;
+
+        if (mode->getIndex() != rhythm::mask)
+        {
+            processor.setRhythmMask(processor.getActiveRhythm());
+            mode->beginChangeGesture();
+            *mode = rhythm::mask;
+            mode->endChangeGesture();
+        }
+
+        processor.setRhythmMask(processor.getRhythmMask() ^ ((juce::uint64) 1 << i));
+        refresh();
+    }
+
+private:
+    void timerCallback() override
+    {
+        if (isOnScreen(*this))
+            refresh();
+    }
+
+    void refresh()
+    {
+        auto newShown = processor.getActiveRhythm();
+        auto newSteps = processor.rhythmSteps->get();
+
+        if (newShown != shown || newSteps != steps)
+        {
+            shown = newShown;
+            steps = newSteps;
+            repaint();
+        }
+    }
+
+    NewProjectAudioProcessor& processor;
+    juce::uint64 shown = 0;
+    int steps = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RhythmStrip)
+};
+
+//==============================================================================
+// Undo / redo for parameter edits, with how much of the history is in use.
+// Ctrl/Cmd+Z and Ctrl/Cmd+Shift+Z do the same from anywhere in the editor.
+class HistoryStrip : public juce::Component,
+    public RefreshTimer
+{
+public:
+    HistoryStrip(ParameterHistory& h) : history(h)
+    {
+        undoButton.onClick = [this] { history.undo(); refresh(); };
+        addAndMakeVisible(undoButton);
+
+        redoButton.onClick = [this] { history.redo(); refresh(); };
+        addAndMakeVisible(redoButton);
+
+        usageLabel.setJustificationType(juce::Justification::centred);
+        addAndMakeVisible(usageLabel);
+
+        refresh();
+        startTimerHz(4);
+    }
+
+    void paint(juce::Graphics&) override {}
+
+    void resized() override
+    {
+        auto area = getLocalBounds().reduced(4, 2);
+        auto w = area.getWidth() / 4;
+
+        undoButton.setBounds(area.removeFromLeft(w));
+        redoButton.setBounds(area.removeFromLeft(w));
+        usageLabel.setBounds(area);
+    }
+
+    void refresh()
+    {
+        undoButton.setEnabled(history.canUndo());
+        redoButton.setEnabled(history.canRedo());
+
+        usageLabel.setText(juce::String(history.getNumEdits()) + " edits, "
+            + juce::File::descriptionOfSizeInBytes((juce::int64) history.getMemoryUsage()) + " of "
+            + juce::File::descriptionOfSizeInBytes((juce::int64) ParameterHistory::getMemoryLimit()), juce::dontSendNotification);
+    }
+
+private:
+    void timerCallback() override
+    {
+        if (isOnScreen(*this))
+            refresh();
+    }
+
+    ParameterHistory& history;
+    juce::TextButton undoButton{ "Undo" }, redoButton{ "Redo" };
+    juce::Label usageLabel;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(HistoryStrip)
+};
+
+#if AARROW_BLOCK_TIMING
+// Small strip at the bottom of the editor showing what processBlock costs.
+// Right-click to reset the histogram or save it to a file.
+class BlockTimingOverlay : public juce::Component,
+    public RefreshTimer
+{
+public:
+    BlockTimingOverlay(BlockTimingHistogram& h) : histogram(h)
+    {
+        setInterceptsMouseClicks(true, false);
+        startTimerHz(4);
+    }
+
+    void paint(juce::Graphics& g) override
+    {
+        AARROW_TRACE_ZONE("BlockTimingOverlay::paint");
+        g.fillAll(juce::Colours::black.withAlpha(0.6f));
+        g.setColour(juce::Colours::cyan);
+        g.setFont(12.0f);
+        g.drawFittedText(text, getLocalBounds().reduced(6, 0), juce::Justification::centredLeft, 1);
+    }
+
+    void mouseDown(const juce::MouseEvent& e) override
+    {
+        if (!e.mods.isPopupMenu())
+            return;
+
+        juce::PopupMenu menu;
+        menu.addItem(1, "Reset timing");
+        menu.addItem(2, "Save timing to file...");
+#if AARROW_TRACING
+        menu.addItem(3, "Save Chrome trace...");
+#endif
+        menu.showMenuAsync(juce::PopupMenu::Options().withTargetComponent(this), [this](int result)
+            {
+                if (result == 1)
+                    histogram.reset();
+                else if (result == 2)
+                    saveToFile();
+                else if (result == 3)
+                    saveTrace();
+            });
+    }
+
+private:
+    void timerCallback() override
+    {
+        AARROW_TRACE_ZONE("BlockTimingOverlay::timerCallback");
+
+        if (!isOnScreen(*this))
+            return;
+
+        auto s = histogram.getSummary();
+        auto newText = "mean " + juce::String(s.meanMicros, 1) + "us  p99 " + juce::String(s.p99Micros, 1)
+            + "us  max " + juce::String(s.maxMicros, 1) + "us  load " + juce::String(s.meanLoad, 1)
+            + "% / " + juce::String(s.maxLoad, 0) + "%";
+
+        if (newText != text)
+        {
+            text = newText;
+            repaint();
+        }
+    }
+
+    void saveToFile()
+    {
+        chooser = std::make_unique<juce::FileChooser>("Save block timing",
+            juce::File::getSpecialLocation(juce::File::userDocumentsDirectory).getChildFile("ArpeggiatorTiming.csv"), "*.csv");
+
+        chooser->launchAsync(juce::FileBrowserComponent::saveMode | juce::FileBrowserComponent::canSelectFiles,
+            [this](const juce::FileChooser& fc)
+            {
+                auto file = fc.getResult();
+                if (file != juce::File())
+                    histogram.dumpToFile(file);
+            });
+    }
+
+    void saveTrace()
+    {
+#if AARROW_TRACING
+        chooser = std::make_unique<juce::FileChooser>("Save Chrome trace",
+            juce::File::getSpecialLocation(juce::File::userDocumentsDirectory).getChildFile("ArpeggiatorTrace.json"), "*.json");
+
+        chooser->launchAsync(juce::FileBrowserComponent::saveMode | juce::FileBrowserComponent::canSelectFiles,
+            [](const juce::FileChooser& fc)
+            {
+                auto file = fc.getResult();
+                if (file != juce::File())
+                    trace::Registry::getInstance().writeChromeTrace(file);
+            });
+#endif
+    }
+
+    BlockTimingHistogram& histogram;
+    juce::String text;
+    std::unique_ptr<juce::FileChooser> chooser;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(BlockTimingOverlay)
+};
+#endif
+
+//=============================================================================
+
 
 //void ParameterDisplayComponent::findChildWithID()
 //{
@@ -919,9 +1588,20 @@ private:
 // 
 //=============================================================================
 
-struct AarrowAudioProcessorEditor::Pimpl
+struct AarrowAudioProcessorEditor::Pimpl : private juce::Timer
 {
-    Pimpl(AarrowAudioProcessorEditor& parent) : owner(parent)
+    Pimpl(AarrowAudioProcessorEditor& parent) : owner(parent),
+        stepView(parent.audioProcessor.getStepEvents()),
+        captureStrip(parent.audioProcessor.getMidiCapture()),
+        patternStrip(parent.audioProcessor.getPattern(), "pattern, e.g. 1-3-2-4 or 1 2(+12) x >*2",
+            [&p = parent.audioProcessor](const juce::String& s) { return p.setPattern(s); }),
+        grooveStrip(parent.audioProcessor.getGroove(), "custom groove, e.g. 0 20 0 20:70 (offset%:velocity%)",
+            [&p = parent.audioProcessor](const juce::String& s) { return p.setGroove(s); }),
+        historyStrip(parent.audioProcessor.getHistory()),
+        rhythmStrip(parent.audioProcessor)
+#if AARROW_BLOCK_TIMING
+        , timingOverlay(parent.audioProcessor.getBlockTiming())
+#endif
     {
         /*auto* p = parent.getAudioProcessor();
          jassert(p != nullptr);
@@ -948,14 +1628,35 @@ struct AarrowAudioProcessorEditor::Pimpl
 
         params.clear();
 
+        params.add(owner.audioProcessor.treeState.getParameter("division"));
+        ParametersPanel* DivisionPanel = new ParametersPanel(owner.audioProcessor, params, false);
+        myPanel->addPanel(DivisionPanel);
+
+        params.clear();
+
+        params.add(owner.audioProcessor.treeState.getParameter("groove"));
+        params.add(owner.audioProcessor.treeState.getParameter("swing"));
+        ParametersPanel* GroovePanel = new ParametersPanel(owner.audioProcessor, params, false);
+        myPanel->addPanel(GroovePanel);
+
+        params.clear();
+
         params.add(owner.audioProcessor.treeState.getParameter("octaves"));
         ParametersPanel* Panel3 = new ParametersPanel(owner.audioProcessor, params, false);
         myPanel->addPanel(Panel3);
 
         params.clear();
 
+        params.add(owner.audioProcessor.treeState.getParameter("root"));
+        params.add(owner.audioProcessor.treeState.getParameter("scale"));
+        ParametersPanel* ScalePanel = new ParametersPanel(owner.audioProcessor, params, false);
+        myPanel->addPanel(ScalePanel);
+
+        params.clear();
+
         params.add(owner.audioProcessor.treeState.getParameter("direction"));
         params.add(owner.audioProcessor.treeState.getParameter("return"));
+        params.add(owner.audioProcessor.treeState.getParameter("retrig"));
         ParametersPanel* Panel4 = new ParametersPanel(owner.audioProcessor, params, true);
         myPanel->addPanel(Panel4);
 
@@ -965,6 +1666,29 @@ struct AarrowAudioProcessorEditor::Pimpl
         ParametersPanel* Panel5 = new ParametersPanel(owner.audioProcessor, params, false);
         myPanel->addPanel(Panel5);
 
+        params.clear();
+
+        params.add(owner.audioProcessor.treeState.getParameter("rhythm"));
+        params.add(owner.audioProcessor.treeState.getParameter("steps"));
+        params.add(owner.audioProcessor.treeState.getParameter("pulses"));
+        params.add(owner.audioProcessor.treeState.getParameter("rotate"));
+        ParametersPanel* RhythmPanel = new ParametersPanel(owner.audioProcessor, params, false);
+        myPanel->addPanel(RhythmPanel);
+
+        params.clear();
+
+        params.add(owner.audioProcessor.treeState.getParameter("onset"));
+        params.add(owner.audioProcessor.treeState.getParameter("sens"));
+        params.add(owner.audioProcessor.treeState.getParameter("pitch"));
+        ParametersPanel* OnsetPanel = new ParametersPanel(owner.audioProcessor, params, false);
+        myPanel->addPanel(OnsetPanel);
+
+        params.clear();
+
+        params.add(owner.audioProcessor.treeState.getParameter("clock"));
+        ParametersPanel* ClockPanel = new ParametersPanel(owner.audioProcessor, params, false);
+        myPanel->addPanel(ClockPanel);
+
         for (auto* comp : myPanel->getChildren())
             auto pie = comp->getComponentID();
         //attach breakpoint if you need help checking componentID's
@@ -978,6 +1702,18 @@ struct AarrowAudioProcessorEditor::Pimpl
         owner.addAndMakeVisible(view);
 
         view.setScrollBarsShown(true, false);
+        owner.addAndMakeVisible(patternStrip);
+        owner.addAndMakeVisible(grooveStrip);
+        owner.addAndMakeVisible(rhythmStrip);
+        owner.addAndMakeVisible(stepView);
+        owner.addAndMakeVisible(captureStrip);
+        owner.addAndMakeVisible(historyStrip);
+
+#if AARROW_BLOCK_TIMING
+        owner.addAndMakeVisible(timingOverlay);
+#endif
+
+        startTimerHz(4);
     }
 
     ~Pimpl()
@@ -987,16 +1723,63 @@ struct AarrowAudioProcessorEditor::Pimpl
 
     void resize(juce::Rectangle<int> size)
     {
+#if AARROW_BLOCK_TIMING
+        timingOverlay.setBounds(size.removeFromBottom(timingHeight));
+#endif
+        historyStrip.setBounds(size.removeFromBottom(historyHeight));
+        captureStrip.setBounds(size.removeFromBottom(captureHeight));
+        stepView.setBounds(size.removeFromBottom(stepViewHeight));
+        rhythmStrip.setBounds(size.removeFromBottom(rhythmHeight));
+        grooveStrip.setBounds(size.removeFromBottom(patternHeight));
+        patternStrip.setBounds(size.removeFromBottom(patternHeight));
         view.setBounds(size);
         auto content = view.getViewedComponent();
         content->setSize(view.getMaximumVisibleWidth(), content->getHeight());
     }
 
+    // Every timer in the editor stops while it can't be seen (minimised, hidden, detached
+    // or covered up) and starts again when it can; this is the only one that keeps going
+    void updateRefreshing()
+    {
+        auto visible = isOnScreen(owner);
+
+        if (visible == refreshing)
+            return;
+
+        refreshing = visible;
+        setRefreshSuspended(owner, !visible);
+    }
+
+    void timerCallback() override
+    {
+        updateRefreshing();
+    }
+
     //==============================================================================
     AarrowAudioProcessorEditor& owner;
     juce::Array<juce::AudioProcessorParameter*> params;
     //LegacyAudioParametersWrapper legacyParameters;
     juce::Viewport view;
+    StepVisualizer stepView;
+    CaptureStrip captureStrip;
+    SourceStrip patternStrip, grooveStrip;
+    HistoryStrip historyStrip;
+    RhythmStrip rhythmStrip;
+
+#if AARROW_BLOCK_TIMING
+    static constexpr int timingHeight = 18;
+    BlockTimingOverlay timingOverlay;
+#else
+    static constexpr int timingHeight = 0;
+#endif
+    static constexpr int captureHeight = 28;
+    static constexpr int stepViewHeight = 44;
+    static constexpr int patternHeight = 28;
+    static constexpr int historyHeight = 24;
+    static constexpr int rhythmHeight = 18;
+    static constexpr int overlayHeight = 2 * patternHeight + rhythmHeight + stepViewHeight + captureHeight + historyHeight + timingHeight;
+
+    bool refreshing = true;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Pimpl)
 };
@@ -1011,9 +1794,10 @@ AarrowAudioProcessorEditor::AarrowAudioProcessorEditor(NewProjectAudioProcessor&
     //addAndMakeVisible(new ParameterDisplayComponent(processor,*audioProcessor.sync));//////>>>>>>>>>>>>>>>>>>>>>>>>>>>
 
     //AarrowLookAndFeel* Aalf = new AarrowLookAndFeel();
-    setLookAndFeel(&Aalf);
+    setLookAndFeel(Aalf.get());
+    setWantsKeyboardFocus(true);
     setSize(pimpl->view.getViewedComponent()->getWidth() + pimpl->view.getVerticalScrollBar().getWidth(),
-        juce::jmin(pimpl->view.getViewedComponent()->getHeight(), 400));
+        juce::jmin(pimpl->view.getViewedComponent()->getHeight(), 400) + Pimpl::overlayHeight);
 
 
 
@@ -1027,6 +1811,8 @@ AarrowAudioProcessorEditor::~AarrowAudioProcessorEditor()
 //==============================================================================
 void AarrowAudioProcessorEditor::paint(juce::Graphics& g)
 {
+    AARROW_TRACE_ZONE("Editor::paint");
+
     // (Our component is opaque, so we must completely fill the background with a solid colour)
     g.fillAll(getLookAndFeel().findColour(juce::ResizableWindow::backgroundColourId));
 
@@ -1042,6 +1828,29 @@ void AarrowAudioProcessorEditor::resized()
     pimpl->resize(getLocalBounds());
 }
 
+void AarrowAudioProcessorEditor::visibilityChanged()
+{
+    if (pimpl != nullptr)
+        pimpl->updateRefreshing();
+}
+
+// undo / redo shortcuts; text boxes keep their own, since they get the keys first
+bool AarrowAudioProcessorEditor::keyPressed(const juce::KeyPress& key)
+{
+    auto& history = audioProcessor.getHistory();
+
+    if (key == juce::KeyPress('z', juce::ModifierKeys::commandModifier, 0))
+        history.undo();
+    else if (key == juce::KeyPress('z', juce::ModifierKeys::commandModifier | juce::ModifierKeys::shiftModifier, 0)
+             || key == juce::KeyPress('y', juce::ModifierKeys::commandModifier, 0))
+        history.redo();
+    else
+        return false;
+
+    pimpl->historyStrip.refresh();
+    return true;
+}
+
 //===================================================================================
 
 
@@ -45,6 +45,8 @@ public:
     //==============================================================================
     void paint(juce::Graphics&) override;
     void resized() override;
+    void visibilityChanged() override;
+    bool keyPressed(const juce::KeyPress&) override;
 
     // This constructor has been changed to take a reference instead of a pointer
     //JUCE_DEPRECATED_WITH_BODY(AarrowAudioProcessorEditor(juce::AudioProcessor* p), : AarrowAudioProcessorEditor(*p) {})
@@ -54,7 +56,9 @@ private:
     NewProjectAudioProcessor& audioProcessor;
     struct Pimpl;
     std::unique_ptr<Pimpl> pimpl;
-    AarrowLookAndFeel Aalf;
+
+    // one look-and-feel shared by every open editor, gone when the last one closes
+    juce::SharedResourcePointer<AarrowLookAndFeel> Aalf;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AarrowAudioProcessorEditor)
 };
@@ -10,21 +10,66 @@
 #include "PluginEditor.h"
 
 //==============================================================================
+// Optional audio input for the Audio Trigger, off until the host connects something.
+// AU MIDI effects can't have audio inputs at all, so they go without.
+static juce::AudioProcessor::BusesProperties withSidechain(juce::AudioProcessor::BusesProperties buses)
+{
+    if (juce::PluginHostType::getPluginLoadedAs() == juce::AudioProcessor::wrapperType_AudioUnit)
+        return buses;
+
+    return buses.withInput("Sidechain", juce::AudioChannelSet::stereo(), false);
+}
+
 NewProjectAudioProcessor::NewProjectAudioProcessor()
 #ifndef JucePlugin_PreferredChannelConfigurations
-    : AudioProcessor(BusesProperties()
+    : AudioProcessor(withSidechain(BusesProperties()
 #if ! JucePlugin_IsMidiEffect
 #if ! JucePlugin_IsSynth
         .withInput("Input", juce::AudioChannelSet::stereo(), true)
 #endif
         .withOutput("Output", juce::AudioChannelSet::stereo(), true)
 #endif
-    ),
-    treeState(*this, nullptr, "PARAMETER_TREE", createParameterLayout())
+    )),
+    treeState(*this, nullptr, "PARAMETER_TREE", createParameterLayout()),
+    midiLearn(treeState, { "speed", "prob", "octaves", "direction", "division", "sync", "return", "d", "trip", "retrig" }),
+    history(getParameters())
 #endif
 {
-
-
+    // looked up once here, so processBlock never searches parameters by ID
+    speed = dynamic_cast<juce::AudioParameterFloat*>(treeState.getParameter("speed"));
+    prob = dynamic_cast<juce::AudioParameterInt*>(treeState.getParameter("prob"));
+    sync = dynamic_cast<juce::AudioParameterBool*>(treeState.getParameter("sync"));
+    turn = dynamic_cast<juce::AudioParameterBool*>(treeState.getParameter("return"));
+    dot = dynamic_cast<juce::AudioParameterBool*>(treeState.getParameter("d"));
+    trip = dynamic_cast<juce::AudioParameterBool*>(treeState.getParameter("trip"));
+    retrig = dynamic_cast<juce::AudioParameterBool*>(treeState.getParameter("retrig"));
+    octaves = dynamic_cast<juce::AudioParameterInt*>(treeState.getParameter("octaves"));
+    direction = dynamic_cast<juce::AudioParameterChoice*>(treeState.getParameter("direction"));
+    division = dynamic_cast<juce::AudioParameterChoice*>(treeState.getParameter("division"));
+    root = dynamic_cast<juce::AudioParameterChoice*>(treeState.getParameter("root"));
+    scale = dynamic_cast<juce::AudioParameterChoice*>(treeState.getParameter("scale"));
+
+    onsetTrigger = dynamic_cast<juce::AudioParameterBool*>(treeState.getParameter("onset"));
+    sensitivity = dynamic_cast<juce::AudioParameterFloat*>(treeState.getParameter("sens"));
+    pitchFollow = dynamic_cast<juce::AudioParameterBool*>(treeState.getParameter("pitch"));
+    clockOutput = dynamic_cast<juce::AudioParameterBool*>(treeState.getParameter("clock"));
+    grooveTemplate = dynamic_cast<juce::AudioParameterChoice*>(treeState.getParameter("groove"));
+    swing = dynamic_cast<juce::AudioParameterInt*>(treeState.getParameter("swing"));
+    rhythmMode = dynamic_cast<juce::AudioParameterChoice*>(treeState.getParameter("rhythm"));
+    rhythmSteps = dynamic_cast<juce::AudioParameterInt*>(treeState.getParameter("steps"));
+    rhythmPulses = dynamic_cast<juce::AudioParameterInt*>(treeState.getParameter("pulses"));
+    rhythmRotation = dynamic_cast<juce::AudioParameterInt*>(treeState.getParameter("rotate"));
+
+    for (int i = 0; i < getBusCount(true); ++i)
+        if (getBus(true, i)->getName() == "Sidechain")
+            sidechainBus = i;
+
+    jassert(midiLearn.getNumTargets() == numLearnTargets);
+    jassert(speed != nullptr && prob != nullptr && sync != nullptr && turn != nullptr && dot != nullptr
+        && trip != nullptr && retrig != nullptr && octaves != nullptr && direction != nullptr && division != nullptr
+        && root != nullptr && scale != nullptr && onsetTrigger != nullptr && sensitivity != nullptr && pitchFollow != nullptr
+        && clockOutput != nullptr && grooveTemplate != nullptr && swing != nullptr
+        && rhythmMode != nullptr && rhythmSteps != nullptr && rhythmPulses != nullptr && rhythmRotation != nullptr);
 }
 
 
@@ -33,21 +78,54 @@ NewProjectAudioProcessor::~NewProjectAudioProcessor()
 }
 //==============================================================================
 // 
+// Every parameter's value is written by one thread and read by the other, so each one
+// gets cache lines to itself rather than sitting next to another parameter's
+template <typename Param>
+using Parameter = CacheLinePadded<Param>;
+
+static_assert(!AARROW_CACHE_LINE_PADDING
+              || (alignof(Parameter<juce::AudioParameterFloat>) == 64 && sizeof(Parameter<juce::AudioParameterFloat>) % 64 == 0
+                  && sizeof(Parameter<juce::AudioParameterInt>) % 64 == 0 && sizeof(Parameter<juce::AudioParameterBool>) % 64 == 0
+                  && sizeof(Parameter<juce::AudioParameterChoice>) % 64 == 0), "parameters share cache lines");
+
 juce::AudioProcessorValueTreeState::ParameterLayout NewProjectAudioProcessor::createParameterLayout()
 {
     juce::AudioProcessorValueTreeState::ParameterLayout params;
 
-    params.add(std::make_unique<juce::AudioParameterFloat>("speed", "-Speed", 0.0f, 1.0f, 0.5f));
-    params.add(std::make_unique<juce::AudioParameterInt>("prob", "-RestProbability", 0,99,0));
-    params.add(std::make_unique<juce::AudioParameterInt>("octaves", "iOctaveCount", 1, 5, 1));
+    params.add(std::make_unique<Parameter<juce::AudioParameterFloat>>("speed", "-Speed", 0.0f, 1.0f, 0.5f));
+    params.add(std::make_unique<Parameter<juce::AudioParameterInt>>("prob", "-RestProbability", 0,99,0));
+    params.add(std::make_unique<Parameter<juce::AudioParameterInt>>("octaves", "iOctaveCount", 1, 5, 1));
+
+
+    params.add(std::make_unique<Parameter<juce::AudioParameterBool>>("sync", "bBPM Link", false));
+    params.add(std::make_unique<Parameter<juce::AudioParameterBool>>("return", "-Return", false));
+    params.add(std::make_unique<Parameter<juce::AudioParameterBool>>("d", "-Dot", false));
+    params.add(std::make_unique<Parameter<juce::AudioParameterBool>>("trip", "-Trip", false));
+    params.add(std::make_unique<Parameter<juce::AudioParameterBool>>("retrig", "-Retrigger", false));
+    params.add(std::make_unique<Parameter<juce::AudioParameterBool>>("onset", "-Audio Trigger", false));
+    params.add(std::make_unique<Parameter<juce::AudioParameterFloat>>("sens", "-Sensitivity", 0.0f, 1.0f, 0.5f));
+    params.add(std::make_unique<Parameter<juce::AudioParameterBool>>("pitch", "-Pitch Follow", false));
+    params.add(std::make_unique<Parameter<juce::AudioParameterBool>>("clock", "-Clock Out", false));
+
+    static const juce::StringArray directionNames{ "Up", "Down", "Random", "Pattern" };    // built once per process
+    params.add(std::make_unique<Parameter<juce::AudioParameterChoice>>("direction", "-Direction", directionNames, directionUp));
 
+    static const juce::StringArray divisionNames(divisions::getNames());
+    params.add(std::make_unique<Parameter<juce::AudioParameterChoice>>("division", "cDivision", divisionNames, divisions::defaultDivision));
 
-    params.add(std::make_unique<juce::AudioParameterBool>("sync", "bBPM Link", false));
-    params.add(std::make_unique<juce::AudioParameterBool>("return", "-Return", false));
-    params.add(std::make_unique<juce::AudioParameterBool>("d", "-Dot", false));
-    params.add(std::make_unique<juce::AudioParameterBool>("trip", "-Trip", false));
+    static const juce::StringArray rootNames(scales::getRootNames()), scaleNames(scales::getScaleNames());
+    params.add(std::make_unique<Parameter<juce::AudioParameterChoice>>("root", "cRoot", rootNames, 0));
+    params.add(std::make_unique<Parameter<juce::AudioParameterChoice>>("scale", "cScale", scaleNames, 0));
 
-    params.add(std::make_unique<juce::AudioParameterChoice>("direction", "-Direction", juce::Array<juce::String>{ "Up", "Down", "Random" }, 0));
+    static const juce::StringArray grooveNames(groove::getNames());
+    params.add(std::make_unique<Parameter<juce::AudioParameterChoice>>("groove", "cGroove", grooveNames, 0));
+    params.add(std::make_unique<Parameter<juce::AudioParameterInt>>("swing", "-Swing", 50, 75, 50));
+
+    static const juce::StringArray rhythmNames(rhythm::getModeNames());
+    params.add(std::make_unique<Parameter<juce::AudioParameterChoice>>("rhythm", "cRhythm", rhythmNames, rhythm::off));
+    params.add(std::make_unique<Parameter<juce::AudioParameterInt>>("steps", "iSteps", 1, rhythm::maxSteps, 16));
+    params.add(std::make_unique<Parameter<juce::AudioParameterInt>>("pulses", "iPulses", 0, rhythm::maxSteps, 5));
+    params.add(std::make_unique<Parameter<juce::AudioParameterInt>>("rotate", "iRotate", 0, rhythm::maxSteps - 1, 0));
 
     return params;
 }
@@ -118,15 +196,28 @@ void NewProjectAudioProcessor::prepareToPlay(double sampleRate, int samplesPerBl
 {
     // Use this method as the place to do any pre-playback
     // initialisation that you need..
-    notes.clear();                          // [1]
-    currentNote = 0;                        // [2]
-    lastNoteValue = -1;                     // [3]
-    time = 0;                               // [4]
+    arp.notes.clear();                      // [1]
+    arp.notes.ensureStorageAllocated(128);  // every note number, so noteEvent() never allocates
+    arp.currentNote = 0;                    // [2]
+    arp.lastNoteValue = -1;                 // [3]
+    arp.time = 0;                           // [4]
+    arp.noteDuration = static_cast<int> (std::ceil(sampleRate * 0.25 * 0.6)); // default speed until the first active block
     tempo = 112;
-    rand = 111;
-    Up = false;
-    Down = false;
-    rate = static_cast<float> (sampleRate); // [5]
+    arp.Up = false;
+    arp.Down = false;
+    arp.rate = static_cast<float> (sampleRate); // [5]
+    processedMidi.ensureSize(4096);
+    samplesProcessed = 0;
+    capture.prepare(sampleRate);
+    onsetDetector.prepare(sampleRate);
+    pitchTracker.prepare(sampleRate, samplesPerBlock);
+    midiClock.reset();
+    pendingNotes.clear();
+    lastScheduled = 0;
+    stepCounter = 0;
+#if AARROW_BLOCK_TIMING
+    blockTiming.prepare(sampleRate);
+#endif
 }
 
 void NewProjectAudioProcessor::releaseResources()
@@ -171,132 +262,493 @@ void NewProjectAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer, ju
     // however we use the buffer to get timing information
     auto numSamples = buffer.getNumSamples();                                                       // [7]
 
-    // new from treestate : ====================================
-    auto dot = treeState.getRawParameterValue("d");
-    auto trip = treeState.getRawParameterValue("trip");
-    auto sync = treeState.getRawParameterValue("sync");
-    auto turn = treeState.getRawParameterValue("return");
-    auto prob = treeState.getRawParameterValue("prob");
-    auto speed = treeState.getRawParameterValue("speed");
-    auto octaves = treeState.getRawParameterValue("octaves");
-    auto direction = treeState.getParameter("direction")->getCurrentValueAsText();
+    const bool sidechainOn = sidechainBus >= 0 && getBus(true, sidechainBus)->isEnabled();
+    const bool pitchMode = pitchFollow->get() && sidechainOn;
+    const bool clockMode = clockOutput->get();
+
+    AARROW_TIME_BLOCK(blockTiming, numSamples)
+
+    // idle: nothing held, nothing sounding, nothing coming in. Just keep the step
+    // clock, the step count and the sample count running, so the next note-on lands
+    // where it would have anyway, on the same rhythm and groove step as the full path
+    // would give it, and a capture keeps the silence between phrases
+    if (idleFastPath && arp.notes.isEmpty() && arp.lastNoteValue < 0 && midi.isEmpty() && !pitchMode
+        && !clockMode && !midiClock.isRunning() && pendingNotes.isEmpty())
+    {
+        stepCounter += (arp.time + numSamples) / arp.noteDuration;
+        arp.time += numSamples;
+        if (arp.time >= arp.noteDuration)
+            arp.time %= arp.noteDuration;
+
+        samplesProcessed += numSamples;
+#if AARROW_TELEMETRY
+        stats.blocksProcessed++;
+        stats.heldNotes = 0;
+        telemetryPublisher.publish(stats);
+#endif
+        return;
+    }
+
+    AARROW_TRACE_ZONE("processBlock");
+    AARROW_TRACE_ARG("blockSize", numSamples);
+#if AARROW_TELEMETRY
+    const auto blockStartTicks = juce::Time::getHighResolutionTicks();
+#endif
+
+    arp.pitchMap = scales::getMap(scale->getIndex(), root->getIndex()).data();
 
     //========================================================== 
-    juce::MidiBuffer processedMidi;
+    processedMidi.clear();
+    generated.clear();
 
-    juce::MidiMessage m;
+    // the configs can't be freed until these go out of scope at the end of the block
+    const ConfigPublisher<EngineConfig>::ScopedRead config(engineConfig);
+    const ConfigPublisher<MidiLearn::Map>::ScopedRead ccMap(midiLearn.getMap());
+    patternMachine.use(config->pattern, config->patternVersion);
 
     if (getPlayHead() != nullptr)
         getPlayHead()->getCurrentPosition(murr);
     tempo = murr.bpm;
-    numerator = murr.timeSigNumerator;
 
+    // Clock Out: this block's ticks and transport, merged in with the notes as they're generated
+    midiClock.process(murr, arp.rate, numSamples, clockMode);
+
+    // parameters : one atomic load each, or the CC last mapped onto them. A CC arriving
+    // mid-block changes these at its sample position and applyParameters() runs again
+    float values[numLearnTargets];
 
+    for (int t = 0; t < numLearnTargets; ++t)
+        values[t] = midiLearn.getValue(t);
 
-    // get note duration
-    syncSpeed = 1 / std::pow(2.0f, (*speed * 100.0f) - 90.0f); // the editor changes range from 90-100 with sync on. this function gives me denomenator of note value
-    auto noteDuration = (!*sync) ?
-        static_cast<int> (std::ceil(rate * 0.25f * (0.1f + (1.0f - (*speed)))))
-        : static_cast<int> (std::ceil(rate * 0.25f * (tempo / 60) * numerator * syncSpeed)); // should correspond to one quarter note w/o syncSpeed
-    if (*dot)
-        noteDuration = noteDuration * 1.5f;
-    if (*trip)
-        noteDuration = (noteDuration * 2.0f) / 3.0f;
+    const int grooveIndex = grooveTemplate->getIndex(), swingPercent = swing->get();
 
-    upDown = (direction == "Down") ? -1 : 1;
+    rhythmGenerator.update(rhythmMode->getIndex(), rhythmSteps->get(), rhythmPulses->get(), rhythmRotation->get(),
+        rhythmMask.load(std::memory_order_relaxed));
 
-    for (const auto metadata : midi)                                                                // Collects notes vertically
+    bool isSynced, turnAround, retrigger, randomOrder, patternOrder;
+    float restProbability;
+    int octaveCount;
+
+    auto applyParameters = [&]
     {
-        const auto msg = metadata.getMessage();
+        isSynced = values[learnSync] >= 0.5f;
+        turnAround = values[learnReturn] >= 0.5f;
+        retrigger = values[learnRetrig] >= 0.5f;
+        restProbability = values[learnProb];
+        octaveCount = juce::roundToInt(values[learnOctaves]);
+
+        const int directionIndex = juce::roundToInt(values[learnDirection]);
+
+        // get note duration: the speed slider when free running, the division table when synced
+        arp.noteDuration = stepLength.get(arp.rate, murr.bpm, murr.timeSigNumerator, murr.timeSigDenominator, isSynced,
+            values[learnSpeed], juce::roundToInt(values[learnDivision]), values[learnDot] >= 0.5f, values[learnTrip] >= 0.5f);
 
-        if (msg.isNoteOn())
+        grooveTable.update(arp.noteDuration, grooveIndex, swingPercent, config->customGroove, config->grooveVersion);
+        gridSynced = isSynced && murr.isPlaying && murr.bpm > 0.0;
+
+        arp.upDown = (directionIndex == directionDown) ? -1 : 1;
+        randomOrder = directionIndex == directionRandom;
+        patternOrder = directionIndex == directionPattern && patternMachine.isLoaded();   // an empty pattern plays Up
+
+        if ((directionIndex == directionUp || (directionIndex == directionPattern && !patternOrder)) && !turnAround)
         {
-            //notes.add(msg.getNoteNumber());
-            for (int i = 0; i < *octaves; i++)
-                if ((msg.getNoteNumber() + (12 * i * upDown)) > 0 && (msg.getNoteNumber() + (12 * i * upDown)) < 127)
-                    notes.add(msg.getNoteNumber() + (12 * i * upDown));
+            arp.Down = false;
+            arp.Up = true;
         }
-        else if (msg.isNoteOff())
+        if (directionIndex == directionDown && !turnAround)
         {
-            //notes.removeValue(msg.getNoteNumber());
-            for (int i = 132; i > -132; i -= 12)
-                notes.removeValue(msg.getNoteNumber() + i);
+            arp.Down = true;
+            arp.Up = false;
         }
+    };
+
+    applyParameters();
+
+    // Audio Trigger: steps land on the hits in the sidechain instead of on the clock
+    const bool onsetMode = onsetTrigger->get() && sidechainOn;
+    grooving = !onsetMode && (grooveIndex != 0 || swingPercent > 50);     // hits keep their own timing
+    int onsets[OnsetDetector::maxOnsetsPerBlock];
+    int numOnsets = 0, nextOnset = 0;
+
+    if (onsetMode)
+        numOnsets = onsetDetector.process(getBusBuffer(buffer, true, sidechainBus), numSamples, sensitivity->get(),
+            onsets, OnsetDetector::maxOnsetsPerBlock);
+
+    // Pitch Follow: the note sung or played into the sidechain is held as if it came in as MIDI
+    PitchTracker::NoteEvent pitchEvents[PitchTracker::maxEventsPerBlock];
+    int numPitchEvents = 0, nextPitchEvent = 0;
+
+    if (pitchMode)
+        numPitchEvents = pitchTracker.process(getBusBuffer(buffer, true, sidechainBus), numSamples,
+            pitchEvents, PitchTracker::maxEventsPerBlock);
+    else if (pitchTracker.getCurrentNote() >= 0)
+    {
+        // switched off (or the sidechain went away) with a note still held
+        pitchEvents[numPitchEvents++] = { 0, pitchTracker.getCurrentNote(), false };
+        pitchTracker.reset();
     }
 
-    if (direction == "Random" && notes.size() > 0)
+    // Walk the block in time order. Note events, mapped CCs and step boundaries are handled
+    // at the sample they fall on, so a step plays exactly the notes held at that sample with
+    // the settings in force there, whatever the buffer size. Events on the same sample as a
+    // step go first.
+    auto event = midi.cbegin();
+    const auto lastEvent = midi.cend();
+    int position = 0;
+
+    // some hosts put events at (or past) the end of the block
+    auto eventPosition = [&event, numSamples] { return juce::jlimit(0, numSamples - 1, (*event).samplePosition); };
+
+    for (;;)
+    {
+        while (event != lastEvent && !MidiMerger::isNoteEvent((*event).data, (*event).numBytes)
+               && !MidiLearn::isController((*event).data, (*event).numBytes))
+            ++event;
+
+        auto nextEvent = juce::jmin((event != lastEvent) ? eventPosition() : numSamples,
+                                    nextPitchEvent < numPitchEvents ? pitchEvents[nextPitchEvent].position : numSamples);
+        auto nextStep = onsetMode ? (nextOnset < numOnsets ? onsets[nextOnset] : numSamples)
+                                  : position + juce::jmax(0, arp.noteDuration - arp.time);          // [11]
+
+        if (nextEvent < numSamples && nextEvent <= nextStep)
+        {
+            const bool wasSilent = arp.notes.isEmpty() && arp.lastNoteValue < 0;
+
+            arp.time += nextEvent - position;
+            position = nextEvent;
+
+            // everything on this sample at once, so a chord is one retrigger and not several
+            bool parametersChanged = false;
+
+            for (; event != lastEvent && eventPosition() == position; ++event)
+            {
+                if (MidiMerger::isNoteEvent((*event).data, (*event).numBytes))
+                    noteEvent((*event).getMessage(), octaveCount);
+                else if (MidiLearn::isController((*event).data, (*event).numBytes))
+                    parametersChanged |= midiLearn.handleController(*ccMap, (*event).data, values) >= 0;
+            }
+
+            for (; nextPitchEvent < numPitchEvents && pitchEvents[nextPitchEvent].position == position; ++nextPitchEvent)
+            {
+                auto& e = pitchEvents[nextPitchEvent];
+                noteEvent(e.isNoteOn ? juce::MidiMessage::noteOn(1, e.note, (juce::uint8) 100)
+                                     : juce::MidiMessage::noteOff(1, e.note), octaveCount);
+            }
+
+            if (parametersChanged)
+                applyParameters();
+
+            // retrigger: the first note-on after silence plays right here, starting the pattern
+            // from its first note, instead of waiting for the next step boundary
+            if (retrigger && wasSilent && arp.notes.size() > 0)
+            {
+                if (patternOrder)
+                    patternMachine.restart();
+                else if (!randomOrder)
+                    arp.currentNote = arp.Up ? arp.notes.size() - 1 : 0;
+
+                playStep(position, randomOrder, patternOrder, turnAround, restProbability, true);
+                arp.time = 0;
+
+                // with sync on, only this step is early; the rest snap back onto the host's grid
+                if (isSynced && murr.isPlaying && murr.bpm > 0.0)
+                {
+                    auto samplesPerBeat = arp.rate * 60.0 / murr.bpm;
+                    auto stepBeats = arp.noteDuration / samplesPerBeat;
+                    auto beat = murr.ppqPosition + position / samplesPerBeat;
+                    arp.time = juce::jmin(arp.noteDuration - 1, static_cast<int> (std::fmod(beat, stepBeats) * samplesPerBeat));
+                }
+            }
+        }
+        else if (nextStep < numSamples)
+        {
+#if AARROW_TELEMETRY
+            // the step length shrank below the time already spent in this step
+            if (!onsetMode && arp.time > arp.noteDuration)
+                ++stats.lateSteps;
+#endif
+            if (onsetMode)
+                ++nextOnset;
+
+            playStep(nextStep, randomOrder, patternOrder, turnAround, restProbability, false);                     // [12]
+            position = nextStep;
+            arp.time = 0;
+        }
+        else
+        {
+            arp.time += numSamples - position;                                                      // [15]
+
+            // with no hits coming in nothing ever resets the step clock, so it mustn't run on forever
+            if (onsetMode)
+                arp.time = juce::jmin(arp.time, arp.noteDuration);
+            break;
+        }
+    }
+
+    flushScheduled(numSamples);
+
+    // non-note input (CC, pitch bend, SysEx...) passes through, generated notes merged in between
+    generated.mergeInto(processedMidi, midi);                                                       // [10]
+
+    if (capture.isRecording())
+    {
+        auto samplesPerBeat = arp.rate * 60.0 / juce::jmax(1.0, murr.bpm);
+
+        for (const auto metadata : processedMidi)
+            if (!MidiClock::isClockMessage(metadata.data, metadata.numBytes))    // no place for these in a MIDI file
+                capture.push(metadata.getMessage(), samplesProcessed + metadata.samplePosition,
+                    murr.ppqPosition + metadata.samplePosition / samplesPerBeat, murr.bpm, murr.isPlaying);
+    }
+
+    samplesProcessed += numSamples;
+
+#if AARROW_TELEMETRY
+    stats.blocksProcessed++;
+    stats.heldNotes = (juce::uint64) arp.notes.size();
+    stats.tempo = murr.bpm;
+    stats.clockTicks += (juce::uint64) midiClock.getNumTicks();
+    stats.maxClockErrorNanos = juce::jmax(stats.maxClockErrorNanos, (juce::uint64) (1.0e9 * midiClock.getMaxErrorSamples() / arp.rate));
+    stats.maxBlockNanos = juce::jmax(stats.maxBlockNanos, (juce::uint64) (1.0e9 * juce::Time::highResolutionTicksToSeconds(
+        juce::Time::getHighResolutionTicks() - blockStartTicks)));
+    telemetryPublisher.publish(stats);
+#endif
+
+    AARROW_TRACE_ARG("heldNotes", arp.notes.size());
+    AARROW_TRACE_ARG("eventsOut", processedMidi.getNumEvents());
+
+    //always use swapWith(), avoids unpredictable behavior from directly editing midi buffer
+    // (the two buffers trade storage every block, so after the first couple of blocks
+    //  both are big enough and nothing gets reallocated)
+    midi.swapWith(processedMidi);
+}
+
+void NewProjectAudioProcessor::noteEvent(const juce::MidiMessage& msg, int octaveCount)
+{
+    if (msg.isNoteOn())
+    {
+        //notes.add(msg.getNoteNumber());
+        for (int i = 0; i < octaveCount; i++)
+            if (juce::isPositiveAndBelow(msg.getNoteNumber() + (12 * i * arp.upDown), 128))
+                arp.notes.add(msg.getNoteNumber() + (12 * i * arp.upDown));
+    }
+    else if (msg.isNoteOff())
+    {
+        //notes.removeValue(msg.getNoteNumber());
+        for (int i = 132; i > -132; i -= 12)
+            arp.notes.removeValue(msg.getNoteNumber() + i);
+    }
+
+    publishStepEvent(StepEventFifo::Event::heldNotes, -1, -1);
+}
+
+void NewProjectAudioProcessor::playStep(int offset, bool randomOrder, bool patternOrder, bool turnAround, float restProbability, bool forceSound)
+{
+    // the groove moves the step later (a retriggered one still plays right on its note).
+    // Nothing goes before a note already scheduled, so the queue stays in order.
+    const auto stepIndex = stepIndexAt(offset);
+    const auto grooveStep = (int) (stepIndex & (groove::numSteps - 1));
+    const auto time = juce::jmax(lastScheduled, samplesProcessed + offset + (grooving && !forceSound ? grooveTable.offset(grooveStep) : 0));
+    const auto velocity = (juce::uint8) juce::jlimit(1, 127, juce::roundToInt(84.0f * (grooving ? grooveTable.velocity(grooveStep) : 1.0f)));
+
+    if (arp.lastNoteValue >= 0)                                                                     // [13]
+    {
+        schedule(time, juce::MidiMessage::noteOff(1, arp.lastNoteValue));
+        arp.lastNoteValue = -1;
+    }
+
+    if (arp.notes.isEmpty())
+        return;
+
+    // the rhythm says whether this step sounds at all; the rest probability is then
+    // a coin flip of its own on each step that does
+    if (!forceSound && (!rhythmGenerator.isOn(stepIndex)
+        || (restProbability > 0.0f && juce::Random::getSystemRandom().nextInt(100) < restProbability)))     // [14]
+    {
+        publishStepEvent(StepEventFifo::Event::step, -1, -1);
+        return;
+    }
+
+    if (patternOrder)
+    {
+        auto step = patternMachine.next(arp.notes);
+
+        if (step.note < 0)
+        {
+            publishStepEvent(StepEventFifo::Event::step, -1, -1);
+            return;
+        }
+
+        arp.currentNote = step.index;
+        arp.lastNoteValue = arp.pitchMap[step.note];
+        emitStep(time, velocity);
+        return;
+    }
+
+    if (randomOrder)
     {
-        rand = juce::Random::getSystemRandom().nextInt(101) + 1;
         //currentNote = rand%notes.size(); // declaring them from the same variable inherently weights the randomizer
-        currentNote = juce::Random::getSystemRandom().nextInt(notes.size());
+        arp.currentNote = juce::Random::getSystemRandom().nextInt(arp.notes.size());
+    }
+    else
+    {
+        arp.currentNote = juce::jlimit(0, arp.notes.size() - 1, arp.currentNote);   // notes may have been released since the last step
     }
 
-    if (direction == "Up")
+    if (arp.Up)
     {
-        rand = 100;
-        if (!*turn)
+        arp.currentNote = (arp.currentNote + 1) % arp.notes.size();
+        if ((arp.currentNote + 1) % arp.notes.size() == 0 && turnAround)
         {
-            Down = false;
-            Up = true;
+            arp.Down = true; arp.Up = false;
         }
     }
-    if (direction == "Down")
+    else
     {
-        rand = 100;
-        if (!*turn)
+        if (arp.Down)
+            arp.currentNote = arp.notes.size() - ((arp.notes.size() - arp.currentNote) % arp.notes.size()) - 1;             // this should run through <OrderedSet>Notes backwards ... ?
+        if (arp.currentNote == 0 && turnAround)
         {
-            Down = true;
-            Up = false;
+            arp.Up = true; arp.Down = false;
         }
     }
 
+    arp.lastNoteValue = arp.pitchMap[arp.notes[arp.currentNote]];
+    emitStep(time, velocity);
+}
+
+void NewProjectAudioProcessor::emitStep(juce::int64 time, juce::uint8 velocity)
+{
+    if (schedule(time, juce::MidiMessage::noteOn(1, arp.lastNoteValue, velocity)))
+    {
+        publishStepEvent(StepEventFifo::Event::step, arp.lastNoteValue, arp.currentNote);
+#if AARROW_TELEMETRY
+        ++stats.stepsEmitted;
+#endif
+    }
+    else
+    {
+        arp.lastNoteValue = -1;
+#if AARROW_TELEMETRY
+        ++stats.droppedSteps;
+#endif
+    }
+}
 
+bool NewProjectAudioProcessor::schedule(juce::int64 time, const juce::MidiMessage& m) noexcept
+{
+    lastScheduled = time;
+    return pendingNotes.push(time, m);
+}
 
+// Step number for the groove and the rhythm: counted from the host's grid when synced,
+// so the swing and the pulses always fall on the same steps of the bar
+juce::int64 NewProjectAudioProcessor::stepIndexAt(int offset) noexcept
+{
+    if (!gridSynced)
+        return stepCounter++;
 
-    midi.clear();                                                                                   // [10]
+    auto samplesPerBeat = arp.rate * 60.0 / murr.bpm;
+    auto stepPosition = (murr.ppqPosition * samplesPerBeat + offset) / arp.noteDuration;
+    return (juce::int64) std::floor(stepPosition + 0.5);
+}
 
-    if ((time + numSamples) >= noteDuration)                                                        // [11]
+// Scheduled notes due in this block and the clock messages, merged in time order.
+// Notes the groove pushed past the end of the block stay queued for the next one.
+// The clock messages still to come always have room kept for them: in a block too
+// dense for everything it's notes that are dropped (and counted), never a tick.
+void NewProjectAudioProcessor::flushScheduled(int numSamples) noexcept
+{
+    for (;;)
     {
-        auto offset = juce::jmax(0, juce::jmin((int)(noteDuration - time), numSamples - 1));     // [12]
+        auto clockAt = midiClock.getNextPosition();
+        auto noteAt = pendingNotes.isEmpty() ? numSamples
+                    : (int) juce::jlimit<juce::int64>(0, numSamples, pendingNotes.front().time - samplesProcessed);
+
+        if (clockAt >= numSamples && noteAt >= numSamples)
+            break;
 
-        if (lastNoteValue > 0)                                                                      // [13]
+        if (clockAt <= noteAt)
         {
-            processedMidi.addEvent(juce::MidiMessage::noteOff(1, lastNoteValue), offset);
-            lastNoteValue = -1;
+            midiClock.flushInto(generated, clockAt);
+            continue;
         }
 
-        if (notes.size() > 0 && rand > *prob)                                                                       // [14]
-        {
-            if (Up)
-            {
-                currentNote = (currentNote + 1) % notes.size();
-                lastNoteValue = notes[currentNote];
-                processedMidi.addEvent(juce::MidiMessage::noteOn(1, lastNoteValue, (juce::uint8)84), offset);
-                if ((currentNote + 1) % notes.size() == 0 && *turn)
-                {
-                    Down = true; Up = false;
-                }
-            }
-            else
-            {
-                if (Down)
-                    currentNote = notes.size() - ((notes.size() - currentNote) % notes.size()) - 1;             // this should run through <OrderedSet>Notes backwards ... ?
-                lastNoteValue = notes[currentNote];
-                processedMidi.addEvent(juce::MidiMessage::noteOn(1, lastNoteValue, (juce::uint8)84), offset);
-                if (currentNote == 0 && *turn)
-                {
-                    Up = true; Down = false;
-                }
-            }
+        const auto& n = pendingNotes.front();
+
+        const bool added = generated.getFreeSpace() > midiClock.getNumPending() && generated.add(juce::MidiMessage(n.data, 3), noteAt);
 
+        if (!added && (n.data[0] & 0xf0) == 0x90)
+        {
+#if AARROW_TELEMETRY
+            ++stats.droppedSteps;
+#endif
         }
 
+        pendingNotes.pop();
     }
+}
 
-    time = (time + numSamples) % noteDuration;                                                      // [15]
+void NewProjectAudioProcessor::publishStepEvent(StepEventFifo::Event::Kind kind, int note, int index) noexcept
+{
+    if (!stepEvents.isActive())
+        return;
 
-    //always use swapWith(), avoids unpredictable behavior from directly editing midi buffer
-    midi.swapWith(processedMidi);
+    StepEventFifo::Event e{ kind, (juce::int8) note, (juce::int16) index, { 0, 0 } };
+
+    for (auto n : arp.notes)
+        e.held[n >> 6] |= (juce::uint64) 1 << (n & 63);
+
+    stepEvents.push(e);
+}
+
+//==============================================================================
+juce::Result NewProjectAudioProcessor::setPattern(const juce::String& source)
+{
+    pattern::Program program;
+    auto result = pattern::compile(source, program);
+
+    if (result.wasOk())
+    {
+        engineConfig.update([&program](EngineConfig& c)
+        {
+            c.pattern = program;
+            ++c.patternVersion;
+        });
+
+        treeState.state.setProperty("pattern", source, nullptr);
+    }
+
+    return result;
+}
+
+void NewProjectAudioProcessor::setRhythmMask(juce::uint64 mask)
+{
+    rhythmMask.store(mask, std::memory_order_relaxed);
+    treeState.state.setProperty("rhythmMask", juce::String::toHexString((juce::int64) mask), nullptr);
+}
+
+juce::uint64 NewProjectAudioProcessor::getActiveRhythm() const
+{
+    return rhythm::make(rhythmMode->getIndex(), rhythmSteps->get(), rhythmPulses->get(), rhythmRotation->get(), getRhythmMask());
+}
+
+juce::Result NewProjectAudioProcessor::setGroove(const juce::String& source)
+{
+    groove::Template map;
+    auto result = groove::parse(source, map);
+
+    if (result.wasOk())
+    {
+        engineConfig.update([&map](EngineConfig& c)
+        {
+            c.customGroove = map;
+            ++c.grooveVersion;
+        });
+
+        treeState.state.setProperty("grooveMap", source, nullptr);
+    }
+
+    return result;
 }
 
 //==============================================================================
@@ -313,6 +765,8 @@ juce::AudioProcessorEditor* NewProjectAudioProcessor::createEditor()
 //==============================================================================
 void NewProjectAudioProcessor::getStateInformation(juce::MemoryBlock& destData)
 {
+    AARROW_TRACE_ZONE("getStateInformation");
+
     // You should use this method to store your parameters in the memory block.
     // You could do that either as raw data, or use the XML or ValueTree classes
     // as intermediaries to make it easy to save and load complex data.
@@ -324,6 +778,9 @@ void NewProjectAudioProcessor::getStateInformation(juce::MemoryBlock& destData)
 
 void NewProjectAudioProcessor::setStateInformation(const void* data, int sizeInBytes)
 {
+    AARROW_TRACE_ZONE("setStateInformation");
+    AARROW_TRACE_ARG("bytes", sizeInBytes);
+
     // You should use this method to restore your parameters from this memory block,
     // whose contents will have been created by the getStateInformation() call.
 
@@ -332,6 +789,21 @@ void NewProjectAudioProcessor::setStateInformation(const void* data, int sizeInB
     if (xmlState.get() != nullptr)
         if (xmlState->hasTagName(treeState.state.getType()))
             treeState.replaceState(juce::ValueTree::fromXml(*xmlState));
+
+    // a pattern that no longer compiles (hand-edited session...) plays as an empty one
+    if (setPattern(getPattern()).failed())
+        setPattern({});
+
+    if (setGroove(getGroove()).failed())
+        setGroove({});
+
+    auto mask = treeState.state.getProperty("rhythmMask").toString();
+    setRhythmMask(mask.isEmpty() ? ~(juce::uint64) 0 : (juce::uint64) mask.getHexValue64());
+
+    midiLearn.restoreFromState();
+
+    // edits made before a preset or session load don't apply to what was loaded
+    history.clear();
 }
 
 //==============================================================================
@@ -9,6 +9,38 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "BlockTiming.h"
+#include "MidiCapture.h"
+#include "TraceZones.h"
+#include "Telemetry.h"
+#include "MidiMerger.h"
+#include "StepEventFifo.h"
+#include "NoteDivisions.h"
+#include "ScaleQuantizer.h"
+#include "Pattern.h"
+#include "ConfigPublisher.h"
+#include "MidiLearn.h"
+#include "OnsetDetector.h"
+#include "PitchTracker.h"
+#include "MidiClock.h"
+#include "ParameterHistory.h"
+#include "Groove.h"
+#include "Rhythm.h"
+
+//==============================================================================
+// Anything the audio thread shares with the message thread: it starts on a cache line
+// of its own and is padded out to a whole number of lines, so nothing else ever sits
+// on the same line at either end of it. Set AARROW_CACHE_LINE_PADDING to 0 to pack
+// everything as before, to measure what the padding buys (arpbench-unpadded).
+#ifndef AARROW_CACHE_LINE_PADDING
+ #define AARROW_CACHE_LINE_PADDING 1
+#endif
+
+template <typename Shared>
+struct alignas(AARROW_CACHE_LINE_PADDING ? 64 : alignof(Shared)) CacheLinePadded : Shared
+{
+    using Shared::Shared;
+};
 
 //==============================================================================
 /**
@@ -28,9 +60,24 @@ public:
     juce::AudioParameterBool* turn;
     juce::AudioParameterBool* dot;
     juce::AudioParameterBool* trip;
+    juce::AudioParameterBool* retrig;
 
     juce::AudioParameterInt* octaves;
     juce::AudioParameterChoice* direction;
+    juce::AudioParameterChoice* division;
+    juce::AudioParameterChoice* root;
+    juce::AudioParameterChoice* scale;
+    juce::AudioParameterBool* onsetTrigger;
+    juce::AudioParameterFloat* sensitivity;
+    juce::AudioParameterBool* pitchFollow;
+    juce::AudioParameterBool* clockOutput;
+    juce::AudioParameterChoice* grooveTemplate;
+    juce::AudioParameterInt* swing;
+    juce::AudioParameterChoice* rhythmMode;
+    juce::AudioParameterInt* rhythmSteps;
+    juce::AudioParameterInt* rhythmPulses;
+    juce::AudioParameterInt* rhythmRotation;
+    enum Direction { directionUp, directionDown, directionRandom, directionPattern };
 
 
 
@@ -70,18 +117,120 @@ public:
     void getStateInformation(juce::MemoryBlock& destData) override;
     void setStateInformation(const void* data, int sizeInBytes) override;
 
+#if AARROW_BLOCK_TIMING
+    BlockTimingHistogram& getBlockTiming() noexcept { return blockTiming; }
+#endif
+    MidiCapture& getMidiCapture() noexcept { return capture; }
+    StepEventFifo& getStepEvents() noexcept { return stepEvents; }
+
+    // message thread: compiles the pattern used by the "Pattern" direction and, if it
+    // parses, hands it to the audio thread and keeps the text in the plugin state
+    juce::Result setPattern(const juce::String& source);
+    juce::String getPattern() const { return treeState.state.getProperty("pattern").toString(); }
+
+    // message thread: same again for the map played by the "Custom" groove
+    juce::Result setGroove(const juce::String& source);
+    juce::String getGroove() const { return treeState.state.getProperty("grooveMap").toString(); }
+
+    // message thread: the steps drawn for the "Mask" rhythm, bit 0 first
+    void setRhythmMask(juce::uint64 mask);
+    juce::uint64 getRhythmMask() const noexcept { return rhythmMask.load(std::memory_order_relaxed); }
+    juce::uint64 getActiveRhythm() const;      // what the current rhythm settings play
+
+    MidiLearn& getMidiLearn() noexcept { return midiLearn; }
+    ParameterHistory& getHistory() noexcept { return history; }
+
+    // Tools/ArpBench turns this off to time the full path against the idle one
+    void setIdleFastPath(bool shouldBeEnabled) noexcept { idleFastPath = shouldBeEnabled; }
+
 private:
     //==============================================================================
-
+    void noteEvent(const juce::MidiMessage& msg, int octaveCount);
+    void playStep(int offset, bool randomOrder, bool patternOrder, bool turnAround, float restProbability, bool forceSound);
+    void emitStep(juce::int64 time, juce::uint8 velocity);
+    bool schedule(juce::int64 time, const juce::MidiMessage& m) noexcept;
+    juce::int64 stepIndexAt(int offset) noexcept;
+    void flushScheduled(int numSamples) noexcept;
+    void publishStepEvent(StepEventFifo::Event::Kind kind, int note, int index) noexcept;
+
+    // Everything processBlock touches on every step, packed into one cache line
+    // of its own so nothing the editor reads or writes can share it.
+    struct alignas(64) StepState
+    {
+        int time = 0;
+        int noteDuration = 1;
+        int currentNote = 0;
+        int lastNoteValue = -1;
+        int upDown = 1;
+        float rate = 44100.0f;
+        bool Up = false, Down = false;
+        juce::SortedSet<int> notes;
+        const juce::uint8* pitchMap = scales::getMap(0, 0).data();     // key the played notes are folded into
+    };
+
+    static_assert(sizeof(StepState) == 64, "StepState has outgrown its cache line");
+
+    StepState arp;
+    divisions::StepLength stepLength;
+    pattern::Machine patternMachine;
+
+    // notes are scheduled rather than written straight out, so a groove can push them late
+    groove::Table grooveTable;
+    groove::NoteQueue pendingNotes;
+    juce::int64 lastScheduled = 0;
+    juce::int64 stepCounter = 0;
+    bool grooving = false, gridSynced = false;
+
+    rhythm::Generator rhythmGenerator;
+    CacheLinePadded<std::atomic<juce::uint64>> rhythmMask{ ~(juce::uint64) 0 };
+
+    // everything too big for a parameter, swapped in as a whole by the message thread
+    struct EngineConfig
+    {
+        pattern::Program pattern;
+        juce::uint32 patternVersion = 0;
+        groove::Template customGroove;
+        juce::uint32 grooveVersion = 0;
+    };
+
+    CacheLinePadded<ConfigPublisher<EngineConfig>> engineConfig;
+
+    // parameters that can be driven by a learned CC, in the order given to midiLearn
+    enum LearnTarget
+    {
+        learnSpeed, learnProb, learnOctaves, learnDirection, learnDivision,
+        learnSync, learnReturn, learnDot, learnTrip, learnRetrig, numLearnTargets
+    };
+
+    CacheLinePadded<MidiLearn> midiLearn;
+    ParameterHistory history;
+    OnsetDetector onsetDetector;
+    PitchTracker pitchTracker;
+    MidiClock midiClock;
+    int sidechainBus = -1;
 
     juce::AudioPlayHead::CurrentPositionInfo murr;
-    int tempo, time, numerator;
-    int currentNote, lastNoteValue;
-    int rndOctave, rndNote, upDown;
-    int rand;
-    float rate;
-    float syncSpeed;
-    bool Up, Down;
-    juce::SortedSet<int> notes;
+    int tempo;
+    int rndOctave, rndNote;
+    juce::MidiBuffer processedMidi;
+    MidiMerger generated;
+    juce::int64 samplesProcessed = 0;
+    bool idleFastPath = true;
+
+    // shared with the editor, so each gets whole cache lines of its own
+    CacheLinePadded<MidiCapture> capture;
+    CacheLinePadded<StepEventFifo> stepEvents;
+#if AARROW_BLOCK_TIMING
+    CacheLinePadded<BlockTimingHistogram> blockTiming;
+    static_assert(!AARROW_CACHE_LINE_PADDING || sizeof(blockTiming) % 64 == 0, "blockTiming shares a cache line");
+#endif
+    static_assert(!AARROW_CACHE_LINE_PADDING || (sizeof(rhythmMask) % 64 == 0 && sizeof(engineConfig) % 64 == 0
+                  && sizeof(midiLearn) % 64 == 0 && sizeof(capture) % 64 == 0 && sizeof(stepEvents) % 64 == 0),
+                  "a shared member shares a cache line");
+
+#if AARROW_TELEMETRY
+    telemetry::Counters stats;
+    TelemetryPublisher telemetryPublisher;
+#endif
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(NewProjectAudioProcessor)
 };
@@ -0,0 +1,131 @@
+/*
+  ==============================================================================
+
+    Rhythm.h
+
+    Which steps sound. A rhythm is up to 64 steps held as the bits of one
+    64-bit word, so playing a step is a single bit test:
+
+        Euclidean   k pulses spread as evenly as possible over n steps,
+                    rotated r steps later. Every (n, k) is worked out at
+                    compile time.
+        Mask        64 steps drawn in the editor, of which the first n play.
+
+    Rest probability is a separate coin flip on each step that the rhythm
+    lets through.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+namespace rhythm
+{
+
+constexpr int maxSteps = 64;
+
+enum Mode { off, euclidean, mask, numModes };
+
+constexpr juce::uint64 lowBits(int n) noexcept
+{
+    return n >= maxSteps ? ~(juce::uint64) 0 : (((juce::uint64) 1 << n) - 1);
+}
+
+// step i is a pulse when (i * k) mod n < k: Bresenham's line through the bar,
+// which gives the same rhythms as Bjorklund's algorithm up to rotation
+constexpr juce::uint64 makeEuclidean(int steps, int pulses) noexcept
+{
+    juce::uint64 bits = 0;
+
+    for (int i = 0; i < steps; ++i)
+        if ((i * pulses) % steps < pulses)
+            bits |= (juce::uint64) 1 << i;
+
+    return bits;
+}
+
+struct EuclideanTable
+{
+    juce::uint64 masks[maxSteps + 1][maxSteps + 1] = {};     // [steps][pulses]
+};
+
+constexpr EuclideanTable makeEuclideanTable() noexcept
+{
+    EuclideanTable t;
+
+    for (int n = 1; n <= maxSteps; ++n)
+        for (int k = 0; k <= n; ++k)
+            t.masks[n][k] = makeEuclidean(n, k);
+
+    return t;
+}
+
+inline constexpr auto euclideanTable = makeEuclideanTable();
+
+static_assert(euclideanTable.masks[8][3] == 0b01001001, "tresillo");
+static_assert(euclideanTable.masks[16][16] == 0xffff, "every step");
+static_assert(euclideanTable.masks[64][64] == ~(juce::uint64) 0, "every step");
+
+// moves every pulse `amount` steps later, wrapping round the n steps
+constexpr juce::uint64 rotate(juce::uint64 bits, int steps, int amount) noexcept
+{
+    amount %= steps;
+
+    if (amount == 0)
+        return bits;
+
+    return ((bits << amount) | (bits >> (steps - amount))) & lowBits(steps);
+}
+
+constexpr juce::uint64 make(int mode, int steps, int pulses, int rotation, juce::uint64 userMask) noexcept
+{
+    steps = steps < 1 ? 1 : (steps > maxSteps ? maxSteps : steps);
+
+    if (mode == euclidean)
+        return rotate(euclideanTable.masks[steps][pulses < 0 ? 0 : (pulses > steps ? steps : pulses)], steps, rotation < 0 ? 0 : rotation);
+
+    if (mode == mask)
+        return userMask & lowBits(steps);
+
+    return lowBits(steps);
+}
+
+inline juce::StringArray getModeNames() { return { "Off", "Euclidean", "Mask" }; }
+
+//==============================================================================
+// The rhythm for the current settings, rebuilt only when one of them changes
+class Generator
+{
+public:
+    void update(int mode, int steps, int pulses, int rotation, juce::uint64 userMask) noexcept
+    {
+        if (mode == lastMode && steps == lastSteps && pulses == lastPulses && rotation == lastRotation && userMask == lastMask)
+            return;
+
+        lastMode = mode;
+        lastSteps = steps;
+        lastPulses = pulses;
+        lastRotation = rotation;
+        lastMask = userMask;
+
+        bits = make(mode, steps, pulses, rotation, userMask);
+        length = juce::jlimit(1, maxSteps, steps);
+    }
+
+    bool isOn(juce::int64 step) const noexcept
+    {
+        auto i = (int) (step % length);
+        return (bits >> (i < 0 ? i + length : i)) & 1;
+    }
+
+private:
+    juce::uint64 bits = ~(juce::uint64) 0;
+    int length = 1;
+
+    int lastMode = -1, lastSteps = -1, lastPulses = -1, lastRotation = -1;
+    juce::uint64 lastMask = 0;
+};
+
+} // namespace rhythm
@@ -0,0 +1,115 @@
+/*
+  ==============================================================================
+
+    ScaleQuantizer.h
+
+    Folds the notes the arp plays into a key. Every root x scale pair has its
+    own 128-entry pitch map, all generated at compile time, so quantizing a
+    note is one array load and the tables sit in read-only data shared by
+    every instance.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+
+namespace scales
+{
+
+//==============================================================================
+struct Scale
+{
+    const char* name;
+    juce::uint16 mask;      // bit n set = n semitones above the root is in the scale
+};
+
+constexpr Scale table[] =
+{
+    { "Off",              0xfff },
+    { "Major",            0xab5 },
+    { "Minor",            0x5ad },
+    { "Harmonic minor",   0x9ad },
+    { "Melodic minor",    0xaad },
+    { "Dorian",           0x6ad },
+    { "Phrygian",         0x5ab },
+    { "Lydian",           0xad5 },
+    { "Mixolydian",       0x6b5 },
+    { "Locrian",          0x56b },
+    { "Major pentatonic", 0x295 },
+    { "Minor pentatonic", 0x4a9 },
+    { "Blues",            0x4e9 },
+    { "Whole tone",       0x555 },
+};
+
+constexpr int numScales = (int) (sizeof(table) / sizeof(table[0]));
+constexpr int numRoots = 12;
+
+using PitchMap = std::array<juce::uint8, 128>;
+
+//==============================================================================
+// Each note goes to the nearest note of the scale, the lower one on a tie,
+// staying inside 0-127.
+constexpr PitchMap makeMap(int root, juce::uint16 mask)
+{
+    // how far down / up the nearest scale note is, for each pitch class
+    int down[12] = {}, up[12] = {};
+
+    for (int pc = 0; pc < 12; ++pc)
+    {
+        while (((mask >> ((pc - down[pc] + 12) % 12)) & 1) == 0) ++down[pc];
+        while (((mask >> ((pc + up[pc]) % 12)) & 1) == 0) ++up[pc];
+    }
+
+    PitchMap map{};
+
+    for (int note = 0; note < 128; ++note)
+    {
+        auto pc = (note - root + 120) % 12;
+        auto goDown = (down[pc] <= up[pc] && note - down[pc] >= 0) || note + up[pc] > 127;
+        map[(size_t) note] = (juce::uint8) (goDown ? note - down[pc] : note + up[pc]);
+    }
+
+    return map;
+}
+
+constexpr std::array<PitchMap, numScales * numRoots> makeAllMaps()
+{
+    std::array<PitchMap, numScales * numRoots> maps{};
+
+    for (int scale = 0; scale < numScales; ++scale)
+        for (int root = 0; root < numRoots; ++root)
+            maps[(size_t) (scale * numRoots + root)] = makeMap(root, table[scale].mask);
+
+    return maps;
+}
+
+inline constexpr auto maps = makeAllMaps();
+
+static_assert(maps[0][61] == 61, "Off leaves notes alone");
+static_assert(maps[numRoots][61] == 60 && maps[numRoots][66] == 65, "C major snaps down on a tie");
+
+//==============================================================================
+inline const PitchMap& getMap(int scale, int root) noexcept
+{
+    return maps[(size_t) (juce::jlimit(0, numScales - 1, scale) * numRoots + juce::jlimit(0, numRoots - 1, root))];
+}
+
+inline juce::StringArray getScaleNames()
+{
+    juce::StringArray names;
+
+    for (const auto& s : table)
+        names.add(s.name);
+
+    return names;
+}
+
+inline juce::StringArray getRootNames()
+{
+    return { "C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B" };
+}
+
+} // namespace scales
@@ -0,0 +1,67 @@
+/*
+  ==============================================================================
+
+    StepEventFifo.h
+
+    Wait-free single-producer/single-consumer channel from the audio thread to
+    the editor's step visualizer. The processor only pushes while an editor
+    is listening; a full FIFO just drops events.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+class StepEventFifo
+{
+public:
+    struct Event
+    {
+        enum Kind : juce::uint8 { heldNotes, step };
+
+        Kind kind;
+        juce::int8 note;            // note played by a step, -1 for a rest
+        juce::int16 index;          // index of that note among the held notes
+        juce::uint64 held[2];       // held-note set as a 128-bit mask
+    };
+
+    void setActive(bool shouldBeActive) noexcept { active.store(shouldBeActive, std::memory_order_release); }
+    bool isActive() const noexcept { return active.load(std::memory_order_acquire); }
+
+    // audio thread
+    void push(const Event& e) noexcept
+    {
+        int start1, size1, start2, size2;
+        fifo.prepareToWrite(1, start1, size1, start2, size2);
+
+        if (size1 + size2 == 0)
+            return;
+
+        events[(size_t) (size1 > 0 ? start1 : start2)] = e;
+        fifo.finishedWrite(1);
+    }
+
+    // message thread
+    int pop(Event* dest, int maxEvents) noexcept
+    {
+        int start1, size1, start2, size2;
+        fifo.prepareToRead(maxEvents, start1, size1, start2, size2);
+
+        std::copy_n(events.begin() + start1, size1, dest);
+        std::copy_n(events.begin() + start2, size2, dest + size1);
+
+        fifo.finishedRead(size1 + size2);
+        return size1 + size2;
+    }
+
+private:
+    // drained at 30 Hz, so this covers ~2000 events a second
+    static constexpr int capacity = 64;
+
+    juce::AbstractFifo fifo{ capacity };
+    std::array<Event, capacity> events;
+    std::atomic<bool> active{ false };
+};
@@ -0,0 +1,160 @@
+/*
+  ==============================================================================
+
+    Telemetry.cpp
+
+  ==============================================================================
+*/
+
+#include "Telemetry.h"
+
+#if AARROW_TELEMETRY
+
+#if JUCE_WINDOWS
+ #include <process.h>
+ static std::uint32_t currentProcessId() { return (std::uint32_t) _getpid(); }
+#else
+ #include <fcntl.h>
+ #include <sys/mman.h>
+ #include <sys/stat.h>
+ #include <unistd.h>
+ static std::uint32_t currentProcessId() { return (std::uint32_t) getpid(); }
+#endif
+
+//==============================================================================
+// Maps the segment read/write, creating it if need be, and only ever grows the
+// file: another process may already have it mapped.
+static void* mapSegment(const std::string& path, size_t needed, std::unique_ptr<juce::MemoryMappedFile>& mappedFile)
+{
+   #if JUCE_WINDOWS
+    juce::File file(juce::String(path));
+
+    if (file.getSize() < (juce::int64) needed)
+    {
+        juce::FileOutputStream out(file);
+
+        if (out.openedOk())
+            out.writeRepeatedByte(0, needed - (size_t) out.getPosition());
+    }
+
+    mappedFile = std::make_unique<juce::MemoryMappedFile>(file, juce::Range<juce::int64>(0, (juce::int64) needed), juce::MemoryMappedFile::readWrite);
+
+    if (mappedFile->getData() == nullptr || mappedFile->getSize() < needed)
+    {
+        mappedFile.reset();
+        return nullptr;
+    }
+
+    return mappedFile->getData();
+   #else
+    juce::ignoreUnused(mappedFile);
+
+    // never through a symlink, and only a plain file of our own
+    auto fd = open(path.c_str(), O_RDWR | O_CREAT | O_NOFOLLOW | O_CLOEXEC, 0600);
+
+    if (fd < 0)
+        return nullptr;
+
+    struct stat info;
+    auto usable = fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_uid == getuid()
+               && (info.st_size >= (off_t) needed || ftruncate(fd, (off_t) needed) == 0);
+
+    auto* data = usable ? mmap(nullptr, needed, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+
+    return data == MAP_FAILED ? nullptr : data;
+   #endif
+}
+
+//==============================================================================
+TelemetryPublisher::SharedMapping::SharedMapping() : pid(currentProcessId())
+{
+    auto* data = mapSegment(telemetry::getSegmentPath(), sizeof(telemetry::Segment), mappedFile);
+
+    if (data == nullptr)
+        return;
+
+    auto* s = static_cast<telemetry::Segment*>(data);
+
+    // whoever gets here first stamps the header; the stores are idempotent
+    s->version.store(telemetry::version);
+    s->numSlots.store(telemetry::maxSlots);
+
+    auto currentMagic = s->magic.load();
+    if (currentMagic == 0)
+        s->magic.compare_exchange_strong(currentMagic, telemetry::magic);
+
+    if (s->magic.load() != telemetry::magic)
+    {
+        unmap(s);
+        return;
+    }
+
+    segment = s;
+    startTimer(1000);
+}
+
+TelemetryPublisher::SharedMapping::~SharedMapping()
+{
+    stopTimer();
+
+    if (segment != nullptr)
+        unmap(segment);
+}
+
+void TelemetryPublisher::SharedMapping::unmap(telemetry::Segment* s)
+{
+   #if JUCE_WINDOWS
+    juce::ignoreUnused(s);
+    mappedFile.reset();
+   #else
+    munmap(s, sizeof(telemetry::Segment));
+   #endif
+}
+
+void TelemetryPublisher::SharedMapping::timerCallback()
+{
+    auto now = (std::uint64_t) juce::Time::currentTimeMillis();
+
+    for (auto& s : segment->slots)
+        if (s.ownerPid.load(std::memory_order_relaxed) == pid)
+            s.aliveMs.store(now, std::memory_order_relaxed);
+}
+
+//==============================================================================
+TelemetryPublisher::TelemetryPublisher()
+{
+    auto* segment = mapping->segment;
+
+    if (segment == nullptr)
+        return;
+
+    auto now = (std::uint64_t) juce::Time::currentTimeMillis();
+
+    for (auto& s : segment->slots)
+    {
+        auto owner = s.ownerPid.load();
+        auto alive = s.aliveMs.load();
+
+        if (owner != 0 && now <= alive + telemetry::staleAfterMs)
+            continue;
+
+        // refresh aliveMs before taking ownership, so nobody else can see
+        // the slot as stale while we're in the middle of claiming it
+        if (!s.aliveMs.compare_exchange_strong(alive, now) || !s.ownerPid.compare_exchange_strong(owner, mapping->pid))
+            continue;
+
+        s.instanceId.store(segment->nextInstanceId.fetch_add(1) + 1);
+        s.write({}, now);
+        slot = &s;
+        break;
+    }
+}
+
+TelemetryPublisher::~TelemetryPublisher()
+{
+    if (slot != nullptr)
+        slot->ownerPid.store(0);
+}
+
+#endif
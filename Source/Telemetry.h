@@ -0,0 +1,63 @@
+/*
+  ==============================================================================
+
+    Telemetry.h
+
+    Publishes this instance's counters into the machine-wide telemetry
+    segment (see TelemetryLayout.h) so Tools/ArpMonitor can watch instances
+    whose editor is closed. Set AARROW_TELEMETRY to 0 to compile it out.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "TelemetryLayout.h"
+
+#ifndef AARROW_TELEMETRY
+ #define AARROW_TELEMETRY 1
+#endif
+
+#if AARROW_TELEMETRY
+
+//==============================================================================
+class TelemetryPublisher
+{
+public:
+    // claims a slot in the segment; if that fails publishing is a no-op
+    TelemetryPublisher();
+    ~TelemetryPublisher();
+
+    bool isConnected() const noexcept { return slot != nullptr; }
+
+    // audio thread: wait-free
+    void publish(const telemetry::Counters& counters) noexcept
+    {
+        if (slot != nullptr)
+            slot->write(counters, (std::uint64_t) juce::Time::currentTimeMillis());
+    }
+
+private:
+    // The segment is mapped once per process and shared by every instance in it,
+    // along with one timer that keeps all of this process's slots marked alive.
+    struct SharedMapping : private juce::Timer
+    {
+        SharedMapping();
+        ~SharedMapping() override;
+
+        void timerCallback() override;
+        void unmap(telemetry::Segment*);
+
+        std::unique_ptr<juce::MemoryMappedFile> mappedFile;     // Windows only; elsewhere it's mmap()ed directly
+        telemetry::Segment* segment = nullptr;
+        const std::uint32_t pid;
+    };
+
+    juce::SharedResourcePointer<SharedMapping> mapping;
+    telemetry::Slot* slot = nullptr;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(TelemetryPublisher)
+};
+
+#endif
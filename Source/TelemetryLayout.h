@@ -0,0 +1,139 @@
+/*
+  ==============================================================================
+
+    TelemetryLayout.h
+
+    Layout of the memory-mapped telemetry segment shared by every plugin
+    instance on the machine and read by Tools/ArpMonitor. Deliberately free
+    of JUCE so the monitor can be built with nothing but a C++17 compiler.
+
+    Each instance owns one slot and updates it with a seqlock: the writer
+    bumps the sequence to odd, stores the counters, then bumps it to even.
+    Writing never waits; readers retry if the sequence moved underneath them.
+    aliveMs is touched from the message thread, so a slot whose instance is
+    simply not being processed isn't mistaken for one left by a dead process.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+
+#if ! defined(_WIN32)
+ #include <unistd.h>
+#endif
+
+namespace telemetry
+{
+    constexpr std::uint32_t magic = 0x54505241;   // "ARPT"
+    constexpr std::uint32_t version = 2;
+    constexpr int maxSlots = 256;
+
+    // a slot whose aliveMs is older than this belongs to a dead process
+    constexpr std::uint64_t staleAfterMs = 5000;
+
+    static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "telemetry needs lock-free 64-bit atomics");
+
+    struct Counters
+    {
+        std::uint64_t blocksProcessed = 0;
+        std::uint64_t stepsEmitted = 0;
+        std::uint64_t droppedSteps = 0;
+        std::uint64_t lateSteps = 0;
+        std::uint64_t maxBlockNanos = 0;
+        std::uint64_t heldNotes = 0;
+        std::uint64_t clockTicks = 0;
+        std::uint64_t maxClockErrorNanos = 0;     // furthest a clock tick sat from its exact time
+        double tempo = 0.0;
+    };
+
+    struct alignas(64) Slot
+    {
+        std::atomic<std::uint32_t> ownerPid;
+        std::atomic<std::uint32_t> instanceId;
+        std::atomic<std::uint32_t> sequence;
+        std::atomic<std::uint64_t> heartbeatMs;
+        std::atomic<std::uint64_t> aliveMs;
+
+        std::atomic<std::uint64_t> blocksProcessed, stepsEmitted, droppedSteps, lateSteps;
+        std::atomic<std::uint64_t> maxBlockNanos, heldNotes;
+        std::atomic<std::uint64_t> clockTicks, maxClockErrorNanos;
+        std::atomic<double> tempo;
+
+        void write(const Counters& c, std::uint64_t nowMs) noexcept
+        {
+            auto s = sequence.load(std::memory_order_relaxed);
+            sequence.store(s + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+
+            blocksProcessed.store(c.blocksProcessed, std::memory_order_relaxed);
+            stepsEmitted.store(c.stepsEmitted, std::memory_order_relaxed);
+            droppedSteps.store(c.droppedSteps, std::memory_order_relaxed);
+            lateSteps.store(c.lateSteps, std::memory_order_relaxed);
+            maxBlockNanos.store(c.maxBlockNanos, std::memory_order_relaxed);
+            heldNotes.store(c.heldNotes, std::memory_order_relaxed);
+            clockTicks.store(c.clockTicks, std::memory_order_relaxed);
+            maxClockErrorNanos.store(c.maxClockErrorNanos, std::memory_order_relaxed);
+            tempo.store(c.tempo, std::memory_order_relaxed);
+            heartbeatMs.store(nowMs, std::memory_order_relaxed);
+
+            sequence.store(s + 2, std::memory_order_release);
+        }
+
+        // returns false if the slot is being written right now; just try again
+        bool read(Counters& c, std::uint64_t& heartbeat) const noexcept
+        {
+            auto before = sequence.load(std::memory_order_acquire);
+
+            if (before & 1)
+                return false;
+
+            c.blocksProcessed = blocksProcessed.load(std::memory_order_relaxed);
+            c.stepsEmitted = stepsEmitted.load(std::memory_order_relaxed);
+            c.droppedSteps = droppedSteps.load(std::memory_order_relaxed);
+            c.lateSteps = lateSteps.load(std::memory_order_relaxed);
+            c.maxBlockNanos = maxBlockNanos.load(std::memory_order_relaxed);
+            c.heldNotes = heldNotes.load(std::memory_order_relaxed);
+            c.clockTicks = clockTicks.load(std::memory_order_relaxed);
+            c.maxClockErrorNanos = maxClockErrorNanos.load(std::memory_order_relaxed);
+            c.tempo = tempo.load(std::memory_order_relaxed);
+            heartbeat = heartbeatMs.load(std::memory_order_relaxed);
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return sequence.load(std::memory_order_relaxed) == before;
+        }
+    };
+
+    struct Segment
+    {
+        std::atomic<std::uint32_t> magic;
+        std::atomic<std::uint32_t> version;
+        std::atomic<std::uint32_t> numSlots;
+        std::atomic<std::uint32_t> nextInstanceId;
+        alignas(64) Slot slots[maxSlots];
+    };
+
+    // Per user, so nobody else can plant or hold the file: the runtime dir when there
+    // is one (only we can write there), otherwise the temp dir with our uid in the name.
+    // Either way it's opened with O_NOFOLLOW and has to be a regular file we own.
+    inline std::string getSegmentPath()
+    {
+       #if defined(_WIN32)
+        const char* temp = std::getenv("TEMP");
+        return std::string(temp != nullptr ? temp : "C:\\Windows\\Temp") + "\\AarrowArpTelemetry.bin";
+       #else
+        const char* runtimeDir = std::getenv("XDG_RUNTIME_DIR");
+
+        if (runtimeDir != nullptr && runtimeDir[0] == '/')
+            return std::string(runtimeDir) + "/AarrowArpTelemetry.bin";
+
+        const char* temp = std::getenv("TMPDIR");
+        return std::string(temp != nullptr && temp[0] == '/' ? temp : "/tmp") + "/AarrowArpTelemetry-"
+             + std::to_string((unsigned long) getuid()) + ".bin";
+       #endif
+    }
+}
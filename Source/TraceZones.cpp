@@ -0,0 +1,130 @@
+/*
+  ==============================================================================
+
+    TraceZones.cpp
+
+  ==============================================================================
+*/
+
+#include "TraceZones.h"
+
+#if AARROW_TRACING
+
+namespace trace
+{
+    Registry& Registry::getInstance()
+    {
+        static Registry registry;
+        return registry;
+    }
+
+    Registry::Registry()
+        : startTicks(juce::Time::getHighResolutionTicks()),
+          buffers(new ThreadBuffer[maxThreads])
+    {
+    }
+
+    ThreadBuffer* Registry::getBufferForThisThread() noexcept
+    {
+        // claimed once per thread, so the audio thread only ever pays for a
+        // thread_local load after its first zone
+        thread_local ThreadBuffer* buffer = [this]() -> ThreadBuffer*
+        {
+            auto index = numClaimed.fetch_add(1, std::memory_order_relaxed);
+
+            if (index >= maxThreads)
+                return nullptr;
+
+            auto& b = buffers[index];
+            b.threadId = (juce::uint64) (juce::pointer_sized_uint) juce::Thread::getCurrentThreadId();
+
+            if (juce::MessageManager::existsAndIsCurrentThread())
+                std::snprintf(b.threadName, sizeof(b.threadName), "message thread");
+            else
+                std::snprintf(b.threadName, sizeof(b.threadName), "thread %d", index);
+
+            // claiming the slot doesn't publish it; the exporter skips it until this
+            b.ready.store(true, std::memory_order_release);
+            return &b;
+        }();
+
+        return buffer;
+    }
+
+    bool Registry::writeChromeTrace(const juce::File& file)
+    {
+        const juce::ScopedLock sl(exportLock);
+
+        auto microsPerTick = 1.0e6 / (double) juce::Time::getHighResolutionTicksPerSecond();
+        auto numBuffers = juce::jmin(maxThreads, numClaimed.load(std::memory_order_acquire));
+
+        file.deleteFile();
+        juce::FileOutputStream out(file);
+
+        if (!out.openedOk())
+            return false;
+
+        out << "{\"traceEvents\":[";
+        bool first = true;
+
+        auto separator = [&out, &first]
+        {
+            if (!first)
+                out << ",\n";
+            first = false;
+        };
+
+        for (int i = 0; i < numBuffers; ++i)
+        {
+            auto& b = buffers[i];
+
+            if (!b.ready.load(std::memory_order_acquire))
+                continue;       // claimed, but its thread is still naming it
+
+            auto tid = juce::String((juce::int64) b.threadId);
+
+            separator();
+            out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid
+                << ",\"args\":{\"name\":\"" << b.threadName << "\"}}";
+
+            auto head = b.head.load(std::memory_order_acquire);
+
+            for (auto t = b.tail.load(std::memory_order_relaxed); t != head; ++t)
+            {
+                const auto& e = b.events[t % ThreadBuffer::capacity];
+
+                separator();
+                out << "{\"name\":\"" << e.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << tid
+                    << ",\"ts\":" << juce::String((double) (e.startTicks - startTicks) * microsPerTick, 3)
+                    << ",\"dur\":" << juce::String((double) (e.endTicks - e.startTicks) * microsPerTick, 3);
+
+                if (e.numArgs > 0)
+                {
+                    out << ",\"args\":{";
+
+                    for (int a = 0; a < e.numArgs; ++a)
+                        out << (a > 0 ? "," : "") << "\"" << e.argNames[a] << "\":" << juce::String(e.argValues[a]);
+
+                    out << "}";
+                }
+
+                out << "}";
+            }
+
+            b.tail.store(head, std::memory_order_release);
+
+            if (auto d = b.dropped.exchange(0, std::memory_order_relaxed))
+            {
+                separator();
+                out << "{\"name\":\"dropped zones\",\"ph\":\"C\",\"pid\":1,\"tid\":" << tid
+                    << ",\"ts\":0,\"args\":{\"count\":" << (int) d << "}}";
+            }
+        }
+
+        out << "]}\n";
+        out.flush();
+        return out.getStatus().wasOk();
+    }
+}
+
+#endif
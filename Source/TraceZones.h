@@ -0,0 +1,137 @@
+/*
+  ==============================================================================
+
+    TraceZones.h
+
+    Scoped trace zones written into per-thread lock-free buffers and exported
+    as Chrome trace JSON (chrome://tracing, ui.perfetto.dev). Compiled out
+    unless AARROW_TRACING is set to 1.
+
+        AARROW_TRACE_ZONE("processBlock");
+        AARROW_TRACE_ARG("blockSize", numSamples);
+
+    Only one zone per scope; arguments attach to the zone in the same scope.
+    The trace is saved from the timing strip's right-click menu in the editor.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#ifndef AARROW_TRACING
+ #define AARROW_TRACING 0
+#endif
+
+#if AARROW_TRACING
+
+//==============================================================================
+namespace trace
+{
+    struct Event
+    {
+        static constexpr int maxArgs = 3;
+
+        const char* name;
+        juce::int64 startTicks, endTicks;
+        int numArgs;
+        const char* argNames[maxArgs];
+        juce::int64 argValues[maxArgs];
+    };
+
+    // One single-producer/single-consumer buffer per thread. The owning thread
+    // is the only writer; writeChromeTrace() is the only reader.
+    struct ThreadBuffer
+    {
+        static constexpr int capacity = 4096;
+
+        void push(const Event& e) noexcept
+        {
+            auto h = head.load(std::memory_order_relaxed);
+
+            if (h - tail.load(std::memory_order_acquire) >= (juce::uint32) capacity)
+            {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+
+            events[h % capacity] = e;
+            head.store(h + 1, std::memory_order_release);
+        }
+
+        std::atomic<juce::uint32> head{ 0 }, tail{ 0 }, dropped{ 0 };
+        std::atomic<bool> ready{ false };       // set once the thread's id and name are filled in
+        juce::uint64 threadId = 0;
+        char threadName[32] = {};
+        Event events[capacity];
+    };
+
+    //==============================================================================
+    class Registry
+    {
+    public:
+        static Registry& getInstance();
+
+        // returns nullptr once every slot has been handed out
+        ThreadBuffer* getBufferForThisThread() noexcept;
+
+        // drains every thread buffer into a Chrome trace JSON file
+        bool writeChromeTrace(const juce::File& file);
+
+    private:
+        Registry();
+
+        static constexpr int maxThreads = 16;
+
+        const juce::int64 startTicks;
+        std::atomic<int> numClaimed{ 0 };
+        std::unique_ptr<ThreadBuffer[]> buffers;
+        juce::CriticalSection exportLock;
+    };
+
+    //==============================================================================
+    class ScopedZone
+    {
+    public:
+        explicit ScopedZone(const char* zoneName) noexcept
+            : buffer(Registry::getInstance().getBufferForThisThread())
+        {
+            event.name = zoneName;
+            event.numArgs = 0;
+            event.startTicks = juce::Time::getHighResolutionTicks();
+        }
+
+        ~ScopedZone()
+        {
+            if (buffer != nullptr)
+            {
+                event.endTicks = juce::Time::getHighResolutionTicks();
+                buffer->push(event);
+            }
+        }
+
+        void addArg(const char* argName, juce::int64 value) noexcept
+        {
+            if (event.numArgs < Event::maxArgs)
+            {
+                event.argNames[event.numArgs] = argName;
+                event.argValues[event.numArgs++] = value;
+            }
+        }
+
+    private:
+        ThreadBuffer* buffer;
+        Event event;
+
+        JUCE_DECLARE_NON_COPYABLE(ScopedZone)
+    };
+}
+
+ #define AARROW_TRACE_ZONE(name)        trace::ScopedZone aarrowTraceZone (name)
+ #define AARROW_TRACE_ARG(name, value)  aarrowTraceZone.addArg (name, (juce::int64) (value))
+
+#else
+ #define AARROW_TRACE_ZONE(name)
+ #define AARROW_TRACE_ARG(name, value)
+#endif
@@ -0,0 +1,1063 @@
+/*
+  ==============================================================================
+
+    ArpBench.cpp
+
+    Benchmarks and checks for the processor, run headless:
+
+        arpbench [<name>...]
+
+    With no names it runs all of them. Each one prints what it measured, and
+    the tool exits non-zero if any of their checks failed. Numbers are for
+    the machine and build at hand, so compare runs against each other rather
+    than against anything written down.
+
+    Built from ArpBench.jucer, next to this file; like ArpPipe it compiles the
+    plugin's own Source/ files into a console app. Use the Release config.
+
+  ==============================================================================
+*/
+
+#include "../Source/PluginProcessor.h"
+#include "../Source/PluginEditor.h"
+
+#include <cstdio>
+#include <map>
+#include <thread>
+
+#if defined(__GNUC__)
+ #include <cxxabi.h>
+#endif
+
+#if defined(__GLIBC__)
+ #include <malloc.h>
+#elif JUCE_MAC
+ #include <malloc/malloc.h>
+#endif
+
+#if JUCE_LINUX || JUCE_MAC
+ #include <cerrno>
+ #include <csignal>
+ #include <fcntl.h>
+ #include <spawn.h>
+ #include <sys/wait.h>
+ #include <unistd.h>
+
+ extern char** environ;
+#endif
+
+//==============================================================================
+namespace
+{
+    // a steady transport at a fixed tempo, moved on by the caller
+    class FixedPlayHead : public juce::AudioPlayHead
+    {
+    public:
+        FixedPlayHead(double rate, double tempo) : sampleRate(rate), bpm(tempo) {}
+
+        juce::Optional<PositionInfo> getPosition() const override
+        {
+            PositionInfo info;
+            info.setIsPlaying(isPlaying);
+            info.setBpm(bpm);
+            info.setTimeSignature(juce::AudioPlayHead::TimeSignature{});
+            info.setTimeInSamples(samplePosition);
+            info.setTimeInSeconds((double) samplePosition / sampleRate);
+            info.setPpqPosition((double) samplePosition * bpm / (60.0 * sampleRate));
+            return info;
+        }
+
+        juce::int64 samplePosition = 0;
+        bool isPlaying = true;
+
+    private:
+        double sampleRate, bpm;
+    };
+
+    // one prepared processor with its own buffers, the way a host would run it
+    struct Instance
+    {
+        Instance(double rate, int blockSize, bool withSidechain = false, double tempo = 120.0) : playHead(rate, tempo)
+        {
+            if (withSidechain)
+                processor.enableAllBuses();
+
+            processor.setPlayHead(&playHead);
+            processor.setRateAndBufferSizeDetails(rate, blockSize);
+            processor.prepareToPlay(rate, blockSize);
+
+            audio.setSize(juce::jmax(1, processor.getTotalNumInputChannels(), processor.getTotalNumOutputChannels()), blockSize);
+            audio.clear();
+            midi.ensureSize(4096);
+        }
+
+        ~Instance()
+        {
+            processor.releaseResources();
+        }
+
+        void process()
+        {
+            processor.processBlock(audio, midi);
+            playHead.samplePosition += audio.getNumSamples();
+            midi.clear();
+        }
+
+        // the channels the processor reads its sidechain from
+        juce::AudioBuffer<float> getSidechain()
+        {
+            for (int b = 0; b < processor.getBusCount(true); ++b)
+                if (processor.getBus(true, b)->getName() == "Sidechain")
+                    return processor.getBusBuffer(audio, true, b);
+
+            return {};
+        }
+
+        NewProjectAudioProcessor processor;
+        FixedPlayHead playHead;
+        juce::AudioBuffer<float> audio;
+        juce::MidiBuffer midi;
+    };
+
+    //==============================================================================
+    double nanosSince(juce::int64 startTicks)
+    {
+        return 1.0e9 * juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks);
+    }
+
+    void report(const char* label, double value, const char* unit)
+    {
+        std::printf("  %-36s %12.1f %s\n", label, value, unit);
+    }
+
+    bool check(bool condition, const char* what)
+    {
+        if (!condition)
+            std::printf("  FAILED: %s\n", what);
+
+        return condition;
+    }
+
+    juce::String className(const std::type_info& type)
+    {
+       #if defined(__GNUC__)
+        int status = 0;
+
+        if (auto* name = abi::__cxa_demangle(type.name(), nullptr, nullptr, &status))
+        {
+            juce::String result(name);
+            std::free(name);
+            return result;
+        }
+       #endif
+
+        return type.name();
+    }
+
+    // bytes the allocator has handed out and not had back, or -1 where the platform can't say
+    juce::int64 heapInUse()
+    {
+       #if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+        return (juce::int64) mallinfo2().uordblks;
+       #elif defined(__GLIBC__)
+        return (juce::int64) (unsigned int) mallinfo().uordblks;
+       #elif JUCE_MAC
+        malloc_statistics_t stats;
+        malloc_zone_statistics(nullptr, &stats);
+        return (juce::int64) stats.size_in_use;
+       #else
+        return -1;
+       #endif
+    }
+
+    //==============================================================================
+    // 200 silent instances, run in turn as a host would, with the idle fast path and
+    // without it (each block then takes the full path with nothing to play). The fast
+    // path has to beat the full one, and stay in the low nanoseconds: tens of them,
+    // or a little more with the block timer and telemetry (a clock read and a slot
+    // write per block) compiled in.
+    bool idle()
+    {
+        constexpr int numInstances = 200, blockSize = 64, numBlocks = 2000;
+       #if AARROW_BLOCK_TIMING || AARROW_TELEMETRY
+        constexpr double budgetNanos = 150.0;
+       #else
+        constexpr double budgetNanos = 30.0;
+       #endif
+
+        juce::OwnedArray<Instance> instances;
+        double nanos[2] = {};
+
+        for (int i = 0; i < numInstances; ++i)
+            instances.add(new Instance(48000.0, blockSize));
+
+        for (auto fastPath : { false, true })
+        {
+            for (auto* i : instances)
+                i->processor.setIdleFastPath(fastPath);
+
+            for (int b = 0; b < 100; ++b)      // warm up
+                for (auto* i : instances)
+                    i->process();
+
+            auto start = juce::Time::getHighResolutionTicks();
+
+            for (int b = 0; b < numBlocks; ++b)
+                for (auto* i : instances)
+                    i->process();
+
+            nanos[fastPath ? 1 : 0] = nanosSince(start) / (numBlocks * numInstances);
+            report(fastPath ? "idle block, fast path" : "idle block, full path", nanos[fastPath ? 1 : 0], "ns / instance");
+        }
+
+        auto ok = check(nanos[1] < nanos[0], "the fast path beats the full path");
+        return check(nanos[1] < budgetNanos, "an idle instance stays in the low nanoseconds") && ok;
+    }
+
+    //==============================================================================
+    // Renders the editor into an offscreen image, as a whole and then one paint() at a
+    // time, with each component's own share (children not included) totalled by class
+    bool paint()
+    {
+        constexpr int numFrames = 200;
+
+        Instance instance(48000.0, 512);
+        std::unique_ptr<juce::AudioProcessorEditor> editor(instance.processor.createEditorAndMakeActive());
+        juce::Image image(juce::Image::ARGB, editor->getWidth(), editor->getHeight(), true);
+
+        {
+            juce::Graphics g(image);
+            editor->paintEntireComponent(g, true);      // first frame renders the cached parts
+
+            auto start = juce::Time::getHighResolutionTicks();
+
+            for (int i = 0; i < numFrames; ++i)
+                editor->paintEntireComponent(g, true);
+
+            report("whole editor", nanosSince(start) / numFrames / 1000.0, "us / frame");
+        }
+
+        std::map<juce::String, double> microsByClass;
+
+        std::function<void(juce::Component&)> measure = [&](juce::Component& c)
+        {
+            if (!c.getLocalBounds().isEmpty())
+            {
+                juce::Graphics g(image);
+                g.reduceClipRegion(c.getLocalBounds());
+
+                auto start = juce::Time::getHighResolutionTicks();
+
+                for (int i = 0; i < numFrames; ++i)
+                    c.paint(g);
+
+                microsByClass[className(typeid(c))] += nanosSince(start) / numFrames / 1000.0;
+            }
+
+            for (auto* child : c.getChildren())
+                measure(*child);
+        };
+
+        measure(*editor);
+
+        std::vector<std::pair<juce::String, double>> sorted(microsByClass.begin(), microsByClass.end());
+        std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) { return a.second > b.second; });
+
+        for (auto& [name, micros] : sorted)
+            report(name.toRawUTF8(), micros, "us / frame");
+
+        return check(!image.isNull(), "editor rendered");
+    }
+
+    //==============================================================================
+    // A session load: 200 instances created, prepared and given their first block (with a
+    // note in it) one after another. The first instance also pays for everything built once
+    // per process, so it's reported on its own.
+    bool coldStart()
+    {
+        constexpr int numInstances = 200, blockSize = 512;
+        constexpr double sampleRate = 48000.0;
+        const char* phases[] = { "construct", "prepareToPlay", "first block" };
+
+        FixedPlayHead playHead(sampleRate, 120.0);
+        juce::OwnedArray<NewProjectAudioProcessor> processors;
+        juce::AudioBuffer<float> audio;
+        juce::MidiBuffer midi;
+
+        double first[3] = {}, total[3] = {}, slowest[3] = {};
+
+        for (int i = 0; i < numInstances; ++i)
+        {
+            double nanos[3];
+
+            auto start = juce::Time::getHighResolutionTicks();
+            auto* p = processors.add(new NewProjectAudioProcessor());
+            nanos[0] = nanosSince(start);
+
+            p->setPlayHead(&playHead);
+            p->setRateAndBufferSizeDetails(sampleRate, blockSize);
+
+            start = juce::Time::getHighResolutionTicks();
+            p->prepareToPlay(sampleRate, blockSize);
+            nanos[1] = nanosSince(start);
+
+            audio.setSize(juce::jmax(1, p->getTotalNumInputChannels(), p->getTotalNumOutputChannels()), blockSize);
+            audio.clear();
+            midi.clear();
+            midi.addEvent(juce::MidiMessage::noteOn(1, 60, (juce::uint8) 100), 0);
+
+            start = juce::Time::getHighResolutionTicks();
+            p->processBlock(audio, midi);
+            nanos[2] = nanosSince(start);
+
+            for (int phase = 0; phase < 3; ++phase)
+            {
+                if (i == 0)
+                    first[phase] = nanos[phase];
+                else
+                    total[phase] += nanos[phase];
+
+                slowest[phase] = juce::jmax(slowest[phase], nanos[phase]);
+            }
+        }
+
+        for (int phase = 0; phase < 3; ++phase)
+        {
+            report((juce::String(phases[phase]) + ", first instance").toRawUTF8(), first[phase] / 1000.0, "us");
+            report((juce::String(phases[phase]) + ", mean of the rest").toRawUTF8(), total[phase] / (numInstances - 1) / 1000.0, "us");
+            report((juce::String(phases[phase]) + ", slowest").toRawUTF8(), slowest[phase] / 1000.0, "us");
+        }
+
+        return true;
+    }
+
+    //==============================================================================
+    // What one more instance costs: the objects themselves, the heap behind a prepared
+    // processor and behind its open editor, and what a closed editor leaves behind
+    // (it should be nothing: no components, timers or look-and-feel)
+    bool memory()
+    {
+        constexpr int numInstances = 100, blockSize = 512;
+        constexpr double sampleRate = 48000.0;
+
+        report("processor object", (double) sizeof(NewProjectAudioProcessor), "bytes");
+        report("editor object", (double) sizeof(AarrowAudioProcessorEditor), "bytes");
+
+        if (heapInUse() < 0)
+        {
+            std::printf("  (no heap statistics on this platform)\n");
+            return true;
+        }
+
+        auto makeProcessor = [&]
+        {
+            auto p = std::make_unique<NewProjectAudioProcessor>();
+            p->setRateAndBufferSizeDetails(sampleRate, blockSize);
+            p->prepareToPlay(sampleRate, blockSize);
+            return p;
+        };
+
+        // the first instance and editor build everything shared per process; keep that out of it
+        {
+            auto p = makeProcessor();
+            std::unique_ptr<juce::AudioProcessorEditor> e(p->createEditorAndMakeActive());
+        }
+
+        std::vector<std::unique_ptr<NewProjectAudioProcessor>> processors;
+        std::vector<std::unique_ptr<juce::AudioProcessorEditor>> editors;
+
+        auto before = heapInUse();
+
+        for (int i = 0; i < numInstances; ++i)
+            processors.push_back(makeProcessor());
+
+        auto withProcessors = heapInUse();
+
+        for (auto& p : processors)
+            editors.emplace_back(p->createEditorAndMakeActive());
+
+        auto withEditors = heapInUse();
+        editors.clear();
+        auto editorsClosed = heapInUse();
+
+        report("heap per prepared processor", (double) (withProcessors - before) / numInstances, "bytes");
+        report("heap per open editor", (double) (withEditors - withProcessors) / numInstances, "bytes");
+        report("heap left per closed editor", (double) (editorsClosed - withProcessors) / numInstances, "bytes");
+
+        // a little slack for allocator bookkeeping and caches that only grow
+        return check(editorsClosed - withProcessors < numInstances * 256, "a closed editor leaves nothing behind");
+    }
+
+    //==============================================================================
+    // 256 instances with chords held, spread over worker threads the way a host spreads
+    // them over its audio threads (neighbours in memory on different threads), with and
+    // without an "editor" thread writing parameters and polling each one's timing all the
+    // while. False sharing shows up as what that thread costs the workers, and as the gap
+    // to the same runs in arpbench-unpadded (the Release Unpadded config, built with
+    // AARROW_CACHE_LINE_PADDING=0), which this runs too when it's been built alongside.
+    bool multiInstance()
+    {
+        constexpr int numInstances = 256, blockSize = 64, numBlocks = 1000;
+
+        juce::OwnedArray<Instance> instances;
+
+        for (int i = 0; i < numInstances; ++i)
+        {
+            auto* instance = instances.add(new Instance(48000.0, blockSize));
+
+            for (auto note : { 60, 64, 67 })
+                instance->midi.addEvent(juce::MidiMessage::noteOn(1, note, (juce::uint8) 100), 0);
+
+            instance->process();
+        }
+
+        const auto maxThreads = juce::jlimit(1, 8, (int) std::thread::hardware_concurrency());
+
+        for (int numThreads = 1; numThreads <= maxThreads; numThreads *= 2)
+        {
+            for (auto editorBusy : { false, true })
+            {
+                std::atomic<bool> running{ true };
+                std::thread editor;
+
+                if (editorBusy)
+                    editor = std::thread([&]
+                    {
+                        juce::Random random;
+
+                        while (running.load(std::memory_order_relaxed))
+                            for (auto* i : instances)
+                            {
+                                i->processor.speed->setValueNotifyingHost(random.nextFloat());
+                               #if AARROW_BLOCK_TIMING
+                                juce::ignoreUnused(i->processor.getBlockTiming().getSummary());
+                               #endif
+                            }
+                    });
+
+                auto start = juce::Time::getHighResolutionTicks();
+                std::vector<std::thread> workers;
+
+                for (int t = 0; t < numThreads; ++t)
+                    workers.emplace_back([&, t]
+                    {
+                        for (int b = 0; b < numBlocks; ++b)
+                            for (int i = t; i < numInstances; i += numThreads)
+                                instances.getUnchecked(i)->process();
+                    });
+
+                for (auto& w : workers)
+                    w.join();
+
+                auto elapsed = nanosSince(start);
+                running.store(false, std::memory_order_relaxed);
+
+                if (editor.joinable())
+                    editor.join();
+
+                auto label = juce::String(numThreads) + (numThreads == 1 ? " thread" : " threads") + (editorBusy ? ", editor busy" : "")
+                           + (AARROW_CACHE_LINE_PADDING ? "" : ", unpadded");
+                report(label.toRawUTF8(), elapsed / ((double) numBlocks * numInstances), "ns / instance-block");
+            }
+        }
+
+       #if AARROW_CACHE_LINE_PADDING
+        auto self = juce::File::getSpecialLocation(juce::File::currentExecutableFile);
+        auto unpadded = self.getSiblingFile("arpbench-unpadded").withFileExtension(self.getFileExtension());
+        juce::ChildProcess child;
+
+        if (unpadded.existsAsFile() && child.start(juce::StringArray{ unpadded.getFullPathName(), "instances" }))
+        {
+            for (auto& line : juce::StringArray::fromLines(child.readAllProcessOutput()))
+                if (line.startsWith("  "))
+                    std::printf("%s\n", line.toRawUTF8());
+        }
+        else
+        {
+            std::printf("  (build the Release Unpadded config too, to compare with the layout before padding)\n");
+        }
+       #endif
+
+        return true;
+    }
+
+    //==============================================================================
+    // A config that can tell when it's been read half-written or after it was freed:
+    // every word of the payload holds the version
+    struct StressConfig
+    {
+        StressConfig() { ++live; }
+        StressConfig(const StressConfig& other) : version(other.version), payload(other.payload) { ++live; }
+        ~StressConfig() { --live; }
+
+        juce::uint64 version = 0;
+        std::array<juce::uint64, 64> payload{};
+
+        inline static std::atomic<int> live{ 0 };
+    };
+
+    // ConfigPublisher with two writers hammering it while a reader spins on the other side
+    // the way processBlock does, then the processor's own configs edited on this thread
+    // while another one runs blocks. Best built with a sanitizer as well.
+    bool configs()
+    {
+        constexpr int numWriters = 2, updatesPerWriter = 100000;
+        auto ok = true;
+
+        {
+            ConfigPublisher<StressConfig> publisher;
+            std::atomic<bool> writing{ true };
+            std::atomic<juce::int64> reads{ 0 }, torn{ 0 }, backwards{ 0 };
+
+            std::thread reader([&]
+            {
+                juce::uint64 last = 0;
+
+                while (writing.load(std::memory_order_relaxed))
+                {
+                    const ConfigPublisher<StressConfig>::ScopedRead config(publisher);
+                    auto version = config->version;
+
+                    if (std::any_of(config->payload.begin(), config->payload.end(), [version](juce::uint64 x) { return x != version; }))
+                        ++torn;
+
+                    if (version < last)
+                        ++backwards;
+
+                    last = version;
+                    ++reads;
+                }
+            });
+
+            auto start = juce::Time::getHighResolutionTicks();
+            std::vector<std::thread> writers;
+
+            for (int w = 0; w < numWriters; ++w)
+                writers.emplace_back([&publisher]
+                {
+                    for (int i = 0; i < updatesPerWriter; ++i)
+                        publisher.update([](StressConfig& c)
+                        {
+                            ++c.version;
+                            c.payload.fill(c.version);
+                        });
+                });
+
+            for (auto& w : writers)
+                w.join();
+
+            auto elapsed = nanosSince(start);
+            writing.store(false, std::memory_order_relaxed);
+            reader.join();
+
+            // nothing is reading any more, so this frees everything retired so far
+            publisher.update([](StressConfig&) {});
+
+            report("update", elapsed / (numWriters * updatesPerWriter), "ns");
+            report("reads while updating", (double) reads.load(), "");
+
+            ok = check(torn.load() == 0, "no config read half-written or after it was freed") && ok;
+            ok = check(backwards.load() == 0, "reader never sees an older config") && ok;
+            ok = check(StressConfig::live.load() == 1, "retired configs are all reclaimed") && ok;
+        }
+
+        ok = check(StressConfig::live.load() == 0, "nothing leaked") && ok;
+
+        // the real thing: patterns and grooves swapped under a processor that's playing them
+        Instance instance(48000.0, 64);
+        *instance.processor.direction = NewProjectAudioProcessor::directionPattern;
+        *instance.processor.grooveTemplate = groove::customTemplate;
+
+        for (auto note : { 60, 64, 67, 71 })
+            instance.midi.addEvent(juce::MidiMessage::noteOn(1, note, (juce::uint8) 100), 0);
+
+        std::atomic<bool> playing{ true };
+        std::atomic<juce::int64> blocks{ 0 };
+
+        std::thread audio([&]
+        {
+            while (playing.load(std::memory_order_relaxed))
+            {
+                instance.process();
+                ++blocks;
+            }
+        });
+
+        constexpr int numEdits = 20000;
+        const char* patterns[] = { "1-3-2-4", "1 2(+12) x >*2", "? < < 4(-12)*3", "" };
+        const char* grooves[] = { "0 20 0 20:70", "", "10:120 0:80" };
+
+        for (int i = 0; i < numEdits; ++i)
+        {
+            ok = check(instance.processor.setPattern(patterns[i % 4]).wasOk(), "pattern compiles") && ok;
+            ok = check(instance.processor.setGroove(grooves[i % 3]).wasOk(), "groove parses") && ok;
+        }
+
+        playing.store(false, std::memory_order_relaxed);
+        audio.join();
+
+        report("pattern + groove edits", (double) numEdits, "");
+        report("blocks played meanwhile", (double) blocks.load(), "");
+
+        return ok;
+    }
+
+    //==============================================================================
+    // A drum loop for the Audio Trigger: a decaying noise burst every eighth at 120 bpm, over
+    // a -50 dB noise floor. The detector on its own and then the processor stepping a chord
+    // on the hits, each as a share of one core at 48 kHz in 32-sample blocks.
+    bool onsets()
+    {
+        constexpr double sampleRate = 48000.0;
+        constexpr int blockSize = 32, numSamples = 48000 * 20, spacing = 12000;
+        constexpr int numHits = numSamples / spacing;
+        constexpr double budgetPercent = 3.0;
+        const double audioNanos = 1.0e9 * numSamples / sampleRate;
+
+        juce::AudioBuffer<float> drums(2, numSamples);
+        juce::Random random(1);
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            auto level = 0.003f + 0.8f * std::exp(-(float) (i % spacing) / (0.03f * (float) sampleRate));
+
+            for (int ch = 0; ch < 2; ++ch)
+                drums.setSample(ch, i, (random.nextFloat() * 2.0f - 1.0f) * level);
+        }
+
+        auto ok = true;
+
+        {
+            OnsetDetector detector;
+            detector.prepare(sampleRate);
+
+            int onsets[OnsetDetector::maxOnsetsPerBlock];
+            int found = 0;
+
+            auto start = juce::Time::getHighResolutionTicks();
+
+            for (int s = 0; s < numSamples; s += blockSize)
+            {
+                const juce::AudioBuffer<float> block(drums.getArrayOfWritePointers(), 2, s, blockSize);
+                found += detector.process(block, blockSize, 0.5f, onsets, OnsetDetector::maxOnsetsPerBlock);
+            }
+
+            auto elapsed = nanosSince(start);
+
+            report("detector", elapsed / (numSamples / blockSize), "ns / block");
+            report("detector, share of a core", 100.0 * elapsed / audioNanos, "%");
+            report("hits found", (double) found, ("of " + juce::String(numHits)).toRawUTF8());
+
+            ok = check(found == numHits, "every hit found, and nothing else") && ok;
+            ok = check(100.0 * elapsed / audioNanos < budgetPercent, "detector within a few percent of a core") && ok;
+        }
+
+        Instance instance(sampleRate, blockSize, true);
+        auto sidechain = instance.getSidechain();
+
+        if (sidechain.getNumChannels() == 0)
+        {
+            std::printf("  (no sidechain bus in this build)\n");
+            return ok;
+        }
+
+        *instance.processor.onsetTrigger = true;
+
+        for (auto note : { 60, 64, 67 })
+            instance.midi.addEvent(juce::MidiMessage::noteOn(1, note, (juce::uint8) 100), 0);
+
+        double elapsed = 0.0;
+        int steps = 0;
+
+        for (int s = 0; s < numSamples; s += blockSize)
+        {
+            for (int ch = 0; ch < sidechain.getNumChannels(); ++ch)
+                sidechain.copyFrom(ch, 0, drums, ch % 2, s, blockSize);
+
+            auto start = juce::Time::getHighResolutionTicks();
+            instance.processor.processBlock(instance.audio, instance.midi);
+            elapsed += nanosSince(start);
+
+            for (const auto metadata : instance.midi)
+                steps += metadata.getMessage().isNoteOn() ? 1 : 0;
+
+            instance.playHead.samplePosition += blockSize;
+            instance.midi.clear();
+        }
+
+        report("processor, stepping on hits", elapsed / (numSamples / blockSize), "ns / block");
+        report("processor, share of a core", 100.0 * elapsed / audioNanos, "%");
+        report("steps played", (double) steps, "");
+
+        return check(100.0 * elapsed / audioNanos < budgetPercent, "processor within a few percent of a core") && ok;
+    }
+
+    //==============================================================================
+    // Pitch Follow: how long after a sung note starts the tracker holds it, for notes over
+    // its range, then what it costs with one and two sidechain channels at 48 kHz in
+    // 32-sample blocks
+    bool pitch()
+    {
+        constexpr double sampleRate = 48000.0;
+        constexpr int blockSize = 32, silence = 9600, numSamples = 48000 * 20;
+        constexpr double maxLatencyMillis = 60.0;     // the ~43 ms window, two hops and some slack
+        const double audioNanos = 1.0e9 * numSamples / sampleRate;
+
+        PitchTracker tracker;
+        PitchTracker::NoteEvent events[PitchTracker::maxEventsPerBlock];
+        juce::AudioBuffer<float> block(1, blockSize);
+        auto ok = true;
+
+        auto tone = [](double frequency, juce::int64 sample)
+        {
+            return 0.5f * (float) std::sin(juce::MathConstants<double>::twoPi * frequency * (double) sample / sampleRate);
+        };
+
+        for (auto note : { 40, 45, 57, 69, 81 })
+        {
+            auto frequency = juce::MidiMessage::getMidiNoteInHertz(note);
+            int heard = -1;
+            juce::int64 heardAt = -1;
+
+            tracker.prepare(sampleRate, blockSize);
+
+            for (juce::int64 s = 0; s < (juce::int64) sampleRate && heard < 0; s += blockSize)
+            {
+                for (int i = 0; i < blockSize; ++i)
+                    block.setSample(0, i, s + i < silence ? 0.0f : tone(frequency, s + i - silence));
+
+                auto numEvents = tracker.process(block, blockSize, events, PitchTracker::maxEventsPerBlock);
+
+                for (int e = 0; e < numEvents && heard < 0; ++e)
+                    if (events[e].isNoteOn)
+                    {
+                        heard = events[e].note;
+                        heardAt = s + events[e].position;
+                    }
+            }
+
+            auto latency = 1000.0 * (double) (heardAt - silence) / sampleRate;
+            report(("latency, " + juce::MidiMessage::getMidiNoteName(note, true, true, 4)).toRawUTF8(), latency, "ms");
+
+            ok = check(heard == note, "the note sung is the note held") && ok;
+            ok = check(heard < 0 || latency < maxLatencyMillis, "held within 60 ms") && ok;
+        }
+
+        for (auto numChannels : { 1, 2 })
+        {
+            juce::AudioBuffer<float> voice(numChannels, blockSize);
+            tracker.prepare(sampleRate, blockSize);
+
+            double elapsed = 0.0;
+
+            for (juce::int64 s = 0; s < numSamples; s += blockSize)
+            {
+                for (int ch = 0; ch < numChannels; ++ch)
+                    for (int i = 0; i < blockSize; ++i)
+                        voice.setSample(ch, i, tone(220.0, s + i));
+
+                auto start = juce::Time::getHighResolutionTicks();
+                tracker.process(voice, blockSize, events, PitchTracker::maxEventsPerBlock);
+                elapsed += nanosSince(start);
+            }
+
+            auto label = juce::String(numChannels) + (numChannels == 1 ? " channel" : " channels");
+            report((label + ", per block").toRawUTF8(), elapsed / (numSamples / blockSize), "ns");
+            report((label + ", share of a core").toRawUTF8(), 100.0 * elapsed / audioNanos, "%");
+        }
+
+        return ok;
+    }
+
+    //==============================================================================
+    // Clock Out jitter. The clock on its own over a spread of rates, tempos and block sizes,
+    // where every tick has to land within half a sample of its exact time (the best a whole
+    // sample can do) and none may go missing; then the ticks the processor actually writes
+    // out, timed against where they should be.
+    bool clockJitter()
+    {
+        constexpr double maxErrorSamples = 0.5 + 1.0e-6;
+        auto ok = true;
+
+        {
+            MidiClock midiClock;
+            double worstError = 0.0;
+            int missingTicks = 0;
+
+            for (auto sampleRate : { 44100.0, 48000.0, 96000.0 })
+                for (auto bpm : { 60.0, 97.3, 120.0, 174.6, 300.0 })
+                    for (auto blockSize : { 1, 32, 64, 441, 512, 1024, 4096 })
+                    {
+                        const auto numSamples = (juce::int64) (sampleRate * 20.0);
+                        const auto samplesPerTick = sampleRate * 60.0 / (bpm * MidiClock::ticksPerQuarterNote);
+                        juce::AudioPlayHead::CurrentPositionInfo position;
+                        juce::int64 numTicks = 0;
+
+                        position.isPlaying = true;
+                        position.bpm = bpm;
+                        midiClock.reset();
+
+                        for (juce::int64 s = 0; s < numSamples; s += blockSize)
+                        {
+                            position.ppqPosition = (double) s * bpm / (60.0 * sampleRate);
+                            midiClock.process(position, sampleRate, (int) juce::jmin((juce::int64) blockSize, numSamples - s), true);
+
+                            numTicks += midiClock.getNumTicks();
+                            worstError = juce::jmax(worstError, midiClock.getMaxErrorSamples());
+                        }
+
+                        // the ones that round onto the sample after the last belong to the next block
+                        auto expected = (juce::int64) std::ceil(((double) numSamples - 0.5) / samplesPerTick);
+                        missingTicks += numTicks == expected ? 0 : 1;
+                    }
+
+            report("clock alone, worst tick error", worstError, "samples");
+            ok = check(worstError <= maxErrorSamples, "every tick within half a sample") && ok;
+            ok = check(missingTicks == 0, "no tick lost or doubled at a block boundary") && ok;
+        }
+
+        constexpr double sampleRate = 48000.0, bpm = 97.3;
+        constexpr int blockSize = 128, numBlocks = 48000 * 20 / blockSize;
+        const auto samplesPerTick = sampleRate * 60.0 / (bpm * MidiClock::ticksPerQuarterNote);
+
+        Instance instance(sampleRate, blockSize, false, bpm);
+        *instance.processor.clockOutput = true;
+
+        juce::int64 numTicks = 0, lastTick = -1;
+        double worstError = 0.0, worstJitter = 0.0;
+        bool started = false;
+
+        for (int b = 0; b < numBlocks; ++b)
+        {
+            instance.processor.processBlock(instance.audio, instance.midi);
+
+            for (const auto metadata : instance.midi)
+            {
+                started = started || metadata.data[0] == 0xfa;
+
+                if (metadata.data[0] != 0xf8)
+                    continue;
+
+                auto time = instance.playHead.samplePosition + metadata.samplePosition;
+                worstError = juce::jmax(worstError, std::abs((double) time - (double) numTicks * samplesPerTick));
+
+                if (lastTick >= 0)
+                    worstJitter = juce::jmax(worstJitter, std::abs((double) (time - lastTick) - samplesPerTick));
+
+                lastTick = time;
+                ++numTicks;
+            }
+
+            instance.playHead.samplePosition += blockSize;
+            instance.midi.clear();
+        }
+
+        report("processor, ticks sent", (double) numTicks, "");
+        report("processor, worst tick error", worstError, "samples");
+        report("processor, worst tick-to-tick jitter", worstJitter, "samples");
+
+        ok = check(started, "Start sent before the first tick") && ok;
+        ok = check(numTicks == (juce::int64) std::ceil((numBlocks * blockSize - 0.5) / samplesPerTick), "every tick sent") && ok;
+        ok = check(worstError <= maxErrorSamples, "ticks written out within half a sample") && ok;
+        ok = check(worstJitter <= 2.0 * maxErrorSamples, "tick spacing never off by more than a sample") && ok;
+
+        return ok;
+    }
+
+    //==============================================================================
+    // arppipe end to end, startup included: a dense stream of notes written into its stdin
+    // by one thread while this one drains its stdout, so the pipes, the framing and the
+    // backpressure are all in the measurement. arppipe has to be built next to arpbench.
+    bool pipeThroughput()
+    {
+       #if JUCE_LINUX || JUCE_MAC
+        constexpr int numEvents = 4000000, eventsPerSample = 4;
+        constexpr double sampleRate = 48000.0, minEventsPerSecond = 1.0e6;
+
+        auto arppipe = juce::File::getSpecialLocation(juce::File::currentExecutableFile).getSiblingFile("arppipe");
+
+        if (!arppipe.existsAsFile())
+        {
+            std::printf("  (no arppipe next to arpbench: build Tools/ArpPipe.jucer as well)\n");
+            return true;
+        }
+
+        // notes going on and off all the time with four held, four events to a sample
+        std::vector<juce::uint8> input((size_t) numEvents * 8, 0);
+
+        for (int i = 0; i < numEvents; ++i)
+        {
+            auto* frame = input.data() + (size_t) i * 8;
+            auto isNoteOn = i % 2 == 0;
+
+            frame[0] = i % eventsPerSample == 0 ? 1 : 0;
+            frame[4] = 3;
+            frame[5] = isNoteOn ? 0x90 : 0x80;
+            frame[6] = (juce::uint8) (48 + (i / 2 + (isNoteOn ? 0 : 20)) % 24);    // off: the note on four pairs back
+            frame[7] = 100;
+        }
+
+        int toPipe[2], fromPipe[2];
+
+        if (::pipe(toPipe) != 0)
+            return check(false, "pipe created");
+
+        if (::pipe(fromPipe) != 0)
+        {
+            ::close(toPipe[0]);
+            ::close(toPipe[1]);
+            return check(false, "pipe created");
+        }
+
+        for (auto fd : { toPipe[0], toPipe[1], fromPipe[0], fromPipe[1] })
+            ::fcntl(fd, F_SETFD, FD_CLOEXEC);      // dup2 below clears it again on arppipe's stdin and stdout
+
+        posix_spawn_file_actions_t actions;
+        posix_spawn_file_actions_init(&actions);
+        posix_spawn_file_actions_adddup2(&actions, toPipe[0], 0);
+        posix_spawn_file_actions_adddup2(&actions, fromPipe[1], 1);
+
+        const auto path = arppipe.getFullPathName();
+        char* argv[] = { const_cast<char*>(path.toRawUTF8()), nullptr };
+        pid_t pid = 0;
+
+        auto start = juce::Time::getHighResolutionTicks();
+        auto spawned = posix_spawn(&pid, path.toRawUTF8(), &actions, nullptr, argv, environ) == 0;
+
+        posix_spawn_file_actions_destroy(&actions);
+        ::close(toPipe[0]);
+        ::close(fromPipe[1]);
+
+        if (!spawned)
+        {
+            ::close(toPipe[1]);
+            ::close(fromPipe[0]);
+            return check(false, "arppipe started");
+        }
+
+        auto previousHandler = std::signal(SIGPIPE, SIG_IGN);     // arppipe quitting early shows up as a failed write
+
+        std::thread writer([&]
+        {
+            auto* data = input.data();
+            auto remaining = input.size();
+
+            while (remaining > 0)
+            {
+                auto n = ::write(toPipe[1], data, remaining);
+
+                if (n < 0 && errno == EINTR)
+                    continue;
+
+                if (n <= 0)
+                    break;
+
+                data += n;
+                remaining -= (size_t) n;
+            }
+
+            ::close(toPipe[1]);
+        });
+
+        std::vector<juce::uint8> chunk(65536);
+        juce::int64 bytesOut = 0;
+
+        for (;;)
+        {
+            auto n = ::read(fromPipe[0], chunk.data(), chunk.size());
+
+            if (n < 0 && errno == EINTR)
+                continue;
+
+            if (n <= 0)
+                break;
+
+            bytesOut += n;
+        }
+
+        writer.join();
+        ::close(fromPipe[0]);
+
+        int status = 0;
+        ::waitpid(pid, &status, 0);
+
+        auto elapsed = nanosSince(start);
+        std::signal(SIGPIPE, previousHandler);
+
+        auto eventsPerSecond = 1.0e9 * numEvents / elapsed;
+        report("events in", eventsPerSecond / 1.0e6, "million / s");
+        report("frames out", 1.0e9 * (double) (bytesOut / 8) / elapsed / 1.0e6, "million / s");
+        report("faster than real time", 1.0e9 * numEvents / (eventsPerSample * sampleRate) / elapsed, "x");
+
+        auto ok = check(WIFEXITED(status) && WEXITSTATUS(status) == 0, "arppipe ran to the end of its input");
+        ok = check(bytesOut > 0 && bytesOut % 8 == 0, "whole frames came out") && ok;
+        return check(eventsPerSecond >= minEventsPerSecond, "a million events a second or more") && ok;
+       #else
+        std::printf("  (needs posix_spawn, which this platform doesn't have)\n");
+        return true;
+       #endif
+    }
+
+    //==============================================================================
+    struct Benchmark
+    {
+        const char* name;
+        const char* description;
+        bool (*run)();
+    };
+
+    const Benchmark benchmarks[] =
+    {
+        { "idle", "processBlock with nothing held, with and without the idle fast path", idle },
+        { "paint", "editor rendered offscreen, and paint() cost per component class", paint },
+        { "coldstart", "construction, prepareToPlay and first block for 200 instances", coldStart },
+        { "memory", "heap and object size per instance, with and without the editor", memory },
+        { "instances", "many instances over several threads, with the editor thread busy or not", multiInstance },
+        { "configs", "config publication stress test with concurrent editing", configs },
+        { "onsets", "Audio Trigger cost at 48 kHz in 32-sample blocks", onsets },
+        { "pitch", "Pitch Follow latency over its range, and cost per sidechain channel", pitch },
+        { "clock", "Clock Out jitter, for the clock alone and as written out by the processor", clockJitter },
+        { "pipe", "arppipe throughput, events in and out per second through real pipes", pipeThroughput },
+    };
+
+    void printUsage(const char* name)
+    {
+        std::fprintf(stderr, "usage: %s [<name>...]\n\n", name);
+
+        for (auto& b : benchmarks)
+            std::fprintf(stderr, "  %-12s %s\n", b.name, b.description);
+    }
+}
+
+//==============================================================================
+int main(int argc, char* argv[])
+{
+    juce::StringArray names;
+
+    for (int i = 1; i < argc; ++i)
+        names.add(argv[i]);
+
+    for (auto& n : names)
+        if (std::none_of(std::begin(benchmarks), std::end(benchmarks), [&n](const Benchmark& b) { return n == b.name; }))
+        {
+            printUsage(argv[0]);
+            return 2;
+        }
+
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;     // the processor's timers and value trees want a message manager
+    auto failed = 0;
+
+    for (auto& b : benchmarks)
+    {
+        if (!names.isEmpty() && !names.contains(b.name))
+            continue;
+
+        std::printf("%s: %s\n", b.name, b.description);
+        auto ok = b.run();
+        std::printf("%s: %s\n\n", b.name, ok ? "ok" : "FAILED");
+
+        failed += ok ? 0 : 1;
+    }
+
+    return failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,162 @@
+/*
+  ==============================================================================
+
+    ArpMonitor.cpp
+
+    Command-line monitor for every running Arpeggiator instance on this
+    machine. It only reads the shared telemetry segment, so it never touches
+    an audio thread.
+
+        c++ -std=c++17 -O2 -I../Source ArpMonitor.cpp -o arpmonitor
+        cl /std:c++17 /O2 /I..\Source ArpMonitor.cpp
+
+    Usage: arpmonitor [--once] [--interval <ms>]
+
+  ==============================================================================
+*/
+
+#include "TelemetryLayout.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+#if defined(_WIN32)
+ #define NOMINMAX
+ #include <windows.h>
+#else
+ #include <fcntl.h>
+ #include <sys/mman.h>
+ #include <sys/stat.h>
+ #include <unistd.h>
+#endif
+
+//==============================================================================
+static const telemetry::Segment* mapSegment()
+{
+    auto path = telemetry::getSegmentPath();
+
+   #if defined(_WIN32)
+    auto file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, 0, nullptr);
+
+    if (file == INVALID_HANDLE_VALUE)
+        return nullptr;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart < (LONGLONG) sizeof(telemetry::Segment))
+        return nullptr;
+
+    auto mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+    if (mapping == nullptr)
+        return nullptr;
+
+    return static_cast<const telemetry::Segment*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, sizeof(telemetry::Segment)));
+   #else
+    auto fd = open(path.c_str(), O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+
+    if (fd < 0)
+        return nullptr;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < (off_t) sizeof(telemetry::Segment))
+    {
+        close(fd);
+        return nullptr;
+    }
+
+    auto* data = mmap(nullptr, sizeof(telemetry::Segment), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    return data == MAP_FAILED ? nullptr : static_cast<const telemetry::Segment*>(data);
+   #endif
+}
+
+static std::uint64_t nowMs()
+{
+    using namespace std::chrono;
+    return (std::uint64_t) duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+}
+
+static void printTable(const telemetry::Segment& segment, bool clearScreen)
+{
+    if (clearScreen)
+        std::printf("\x1b[2J\x1b[H");
+
+    std::printf("%-8s %-6s %12s %10s %8s %8s %10s %5s %7s %10s %8s %s\n",
+                "pid", "inst", "blocks", "steps", "dropped", "late", "max us", "held", "bpm", "clock", "jit us", "state");
+
+    auto now = nowMs();
+    int shown = 0;
+
+    for (const auto& slot : segment.slots)
+    {
+        auto pid = slot.ownerPid.load(std::memory_order_acquire);
+
+        if (pid == 0 || now > slot.aliveMs.load(std::memory_order_relaxed) + telemetry::staleAfterMs)
+            continue;
+
+        telemetry::Counters c;
+        std::uint64_t heartbeat = 0;
+        int attempts = 0;
+
+        while (!slot.read(c, heartbeat) && ++attempts < 100)
+            std::this_thread::yield();
+
+        if (attempts == 100)
+            continue;
+
+        std::printf("%-8u %-6u %12llu %10llu %8llu %8llu %10.1f %5llu %7.2f %10llu %8.2f %s\n",
+                    pid, slot.instanceId.load(std::memory_order_relaxed),
+                    (unsigned long long) c.blocksProcessed, (unsigned long long) c.stepsEmitted,
+                    (unsigned long long) c.droppedSteps, (unsigned long long) c.lateSteps,
+                    (double) c.maxBlockNanos / 1000.0, (unsigned long long) c.heldNotes, c.tempo,
+                    (unsigned long long) c.clockTicks, (double) c.maxClockErrorNanos / 1000.0,
+                    now > heartbeat + 1000 ? "idle" : "running");
+        ++shown;
+    }
+
+    if (shown == 0)
+        std::printf("(no live instances)\n");
+
+    std::fflush(stdout);
+}
+
+//==============================================================================
+int main(int argc, char* argv[])
+{
+    bool once = false;
+    int intervalMs = 500;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--once") == 0)
+            once = true;
+        else if (std::strcmp(argv[i], "--interval") == 0 && i + 1 < argc)
+            intervalMs = std::atoi(argv[++i]);
+        else
+        {
+            std::fprintf(stderr, "usage: %s [--once] [--interval <ms>]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    auto* segment = mapSegment();
+
+    if (segment == nullptr || segment->magic.load() != telemetry::magic || segment->version.load() != telemetry::version)
+    {
+        std::fprintf(stderr, "no Arpeggiator telemetry at %s\n", telemetry::getSegmentPath().c_str());
+        return 1;
+    }
+
+    for (;;)
+    {
+        printTable(*segment, !once);
+
+        if (once)
+            return 0;
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(intervalMs > 0 ? intervalMs : 500));
+    }
+}
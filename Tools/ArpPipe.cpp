@@ -0,0 +1,403 @@
+/*
+  ==============================================================================
+
+    ArpPipe.cpp
+
+    Runs the arpeggiator headless in a Unix pipeline: timestamped MIDI comes
+    in on stdin, the arp's output goes out on stdout, on a virtual sample
+    clock that only moves as fast as the input says.
+
+        arppipe [--rate <Hz>] [--block <samples>] [--bpm <tempo>] [--tail <samples>]
+                [--set <paramID>=<value>]... [--pattern "<pattern>"]
+
+    Built from ArpPipe.jucer, next to this file; it compiles the plugin's own
+    Source/ files into a console app.
+
+    Every event in both directions is one 8-byte frame:
+
+        bytes 0-3   samples since the previous frame (uint32, little-endian)
+        byte  4     message length, 1-3, or 0 for a frame that only moves time on
+        bytes 5-7   the message, zero padded (SysEx isn't carried)
+
+    A block runs once the input has moved past its end, so a producer that
+    has nothing to say should still send empty frames to keep time going.
+    At end of input, the blocks up to the last frame (plus --tail) are run
+    and the tool exits.
+
+    Memory stays bounded: stdin is read in fixed chunks, each block holds at
+    most maxEventsPerBlock input events (a block that fills up is cut short
+    there and run early), and the output buffer is written out whenever it
+    fills. stdout writes block, so a slow reader stalls us, we stop reading,
+    and the pipe pushes back on whoever is writing to us.
+
+  ==============================================================================
+*/
+
+#include "../Source/PluginProcessor.h"
+
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+
+#if defined(_WIN32)
+ #include <fcntl.h>
+ #include <io.h>
+#else
+ #include <cerrno>
+ #include <unistd.h>
+#endif
+
+//==============================================================================
+namespace
+{
+    constexpr int frameSize = 8;
+    constexpr int readChunk = 8192 * frameSize;
+    constexpr int writeChunk = 8192 * frameSize;
+    constexpr int maxEventsPerBlock = 65536;
+
+    struct Options
+    {
+        double sampleRate = 48000.0;
+        int blockSize = 512;
+        double bpm = 120.0;
+        juce::int64 tail = 0;
+        juce::StringArray settings;
+        juce::String pattern;
+        bool hasPattern = false;
+    };
+
+    //==============================================================================
+    int readSome(void* dest, int numBytes)
+    {
+       #if defined(_WIN32)
+        return _read(0, dest, (unsigned int) numBytes);
+       #else
+        for (;;)
+        {
+            auto n = ::read(0, dest, (size_t) numBytes);
+
+            if (n >= 0 || errno != EINTR)
+                return (int) n;
+        }
+       #endif
+    }
+
+    bool writeAll(const juce::uint8* data, int numBytes)
+    {
+        while (numBytes > 0)
+        {
+           #if defined(_WIN32)
+            auto n = _write(1, data, (unsigned int) numBytes);
+           #else
+            auto n = ::write(1, data, (size_t) numBytes);
+
+            if (n < 0 && errno == EINTR)
+                continue;
+           #endif
+
+            if (n <= 0)
+                return false;   // reader went away
+
+            data += n;
+            numBytes -= (int) n;
+        }
+
+        return true;
+    }
+
+    //==============================================================================
+    // Fixed tempo, always playing, positioned by the virtual clock
+    class VirtualPlayHead : public juce::AudioPlayHead
+    {
+    public:
+        VirtualPlayHead(double rate, double tempo) : sampleRate(rate), bpm(tempo) {}
+
+        juce::Optional<PositionInfo> getPosition() const override
+        {
+            PositionInfo info;
+            info.setIsPlaying(true);
+            info.setBpm(bpm);
+            info.setTimeSignature(juce::AudioPlayHead::TimeSignature{});
+            info.setTimeInSamples(samplePosition);
+            info.setTimeInSeconds((double) samplePosition / sampleRate);
+            info.setPpqPosition((double) samplePosition * bpm / (60.0 * sampleRate));
+            return info;
+        }
+
+        juce::int64 samplePosition = 0;
+
+    private:
+        double sampleRate, bpm;
+    };
+
+    //==============================================================================
+    class Pipe
+    {
+    public:
+        Pipe(const Options& o) : options(o), playHead(o.sampleRate, o.bpm)
+        {
+            processor.setPlayHead(&playHead);
+            processor.setRateAndBufferSizeDetails(options.sampleRate, options.blockSize);
+            processor.prepareToPlay(options.sampleRate, options.blockSize);
+
+            audio.setSize(juce::jmax(processor.getTotalNumInputChannels(), processor.getTotalNumOutputChannels()), options.blockSize);
+            audio.clear();
+            input.ensureSize((size_t) maxEventsPerBlock * 8);
+            outBuffer.allocate((size_t) writeChunk, false);
+            blockEnd = options.blockSize;
+        }
+
+        ~Pipe()
+        {
+            processor.releaseResources();
+        }
+
+        NewProjectAudioProcessor& getProcessor() noexcept { return processor; }
+
+        bool run()
+        {
+            juce::HeapBlock<juce::uint8> chunk((size_t) readChunk + frameSize);
+            int leftover = 0;
+
+            for (;;)
+            {
+                auto n = readSome(chunk + leftover, readChunk);
+
+                if (n <= 0)
+                    break;
+
+                auto available = leftover + n;
+                auto complete = available - available % frameSize;
+
+                for (int i = 0; i < complete; i += frameSize)
+                    if (!receive(chunk + i))
+                        return false;
+
+                leftover = available - complete;
+                std::memmove(chunk, chunk + complete, (size_t) leftover);
+
+                // hand over what this chunk produced before waiting on stdin again
+                if (!flush())
+                    return false;
+            }
+
+            // end of input: finish the block the last frame was in, then the tail
+            auto end = inputTime + options.tail;
+
+            while (blockStart <= end)
+                if (!runBlock(blockEnd))
+                    return false;
+
+            return flush();
+        }
+
+        juce::int64 getDroppedEvents() const noexcept { return dropped; }
+
+    private:
+        bool receive(const juce::uint8* frame)
+        {
+            juce::uint32 delta = (juce::uint32) frame[0] | ((juce::uint32) frame[1] << 8)
+                               | ((juce::uint32) frame[2] << 16) | ((juce::uint32) frame[3] << 24);
+            auto size = (int) frame[4];
+
+            inputTime += delta;
+
+            while (inputTime >= blockEnd)
+                if (!runBlock(blockEnd))
+                    return false;
+
+            if (size == 0)
+                return true;
+
+            if (size > 3)
+            {
+                ++dropped;
+                return true;
+            }
+
+            // a block that's full is cut short here; the rest of it runs with the next events.
+            // A whole block's worth on one sample can't be cut, so that one is dropped.
+            if (numInputEvents == maxEventsPerBlock)
+            {
+                if (inputTime == blockStart)
+                {
+                    ++dropped;
+                    return true;
+                }
+
+                if (!runBlock(inputTime))
+                    return false;
+            }
+
+            MidiMerger::append(input, frame + 5, size, (int) (inputTime - blockStart));
+            ++numInputEvents;
+            return true;
+        }
+
+        // runs the block from blockStart up to (not including) end
+        bool runBlock(juce::int64 end)
+        {
+            auto numSamples = (int) (end - blockStart);
+
+            audio.setSize(audio.getNumChannels(), numSamples, false, false, true);
+            playHead.samplePosition = blockStart;
+            processor.processBlock(audio, input);
+
+            for (const auto metadata : input)
+                if (!emit(blockStart + juce::jlimit(0, numSamples - 1, metadata.samplePosition), metadata.data, metadata.numBytes))
+                    return false;
+
+            input.clear();
+            numInputEvents = 0;
+
+            blockStart = end;
+
+            if (blockStart == blockEnd)
+                blockEnd += options.blockSize;
+
+            return true;
+        }
+
+        bool emit(juce::int64 time, const juce::uint8* data, int numBytes)
+        {
+            if (numBytes > 3)
+            {
+                ++dropped;
+                return true;
+            }
+
+            if (outSize + frameSize > writeChunk && !flush())
+                return false;
+
+            auto delta = (juce::uint32) (time - outputTime);
+            outputTime = time;
+
+            auto* frame = outBuffer + outSize;
+            frame[0] = (juce::uint8) delta;
+            frame[1] = (juce::uint8) (delta >> 8);
+            frame[2] = (juce::uint8) (delta >> 16);
+            frame[3] = (juce::uint8) (delta >> 24);
+            frame[4] = (juce::uint8) numBytes;
+            frame[5] = frame[6] = frame[7] = 0;
+            std::memcpy(frame + 5, data, (size_t) numBytes);
+
+            outSize += frameSize;
+            return true;
+        }
+
+        bool flush()
+        {
+            auto ok = writeAll(outBuffer, outSize);
+            outSize = 0;
+            return ok;
+        }
+
+        const Options& options;
+        NewProjectAudioProcessor processor;
+        VirtualPlayHead playHead;
+
+        juce::AudioBuffer<float> audio;
+        juce::MidiBuffer input;
+        int numInputEvents = 0;
+
+        juce::int64 inputTime = 0, outputTime = 0;
+        juce::int64 blockStart = 0, blockEnd = 0;
+        juce::int64 dropped = 0;
+
+        juce::HeapBlock<juce::uint8> outBuffer;
+        int outSize = 0;
+    };
+
+    //==============================================================================
+    bool applySetting(NewProjectAudioProcessor& processor, const juce::String& setting)
+    {
+        auto id = setting.upToFirstOccurrenceOf("=", false, false);
+        auto* param = processor.treeState.getParameter(id);
+
+        if (param == nullptr || !setting.containsChar('='))
+            return false;
+
+        param->setValueNotifyingHost(param->getValueForText(setting.fromFirstOccurrenceOf("=", false, false)));
+        return true;
+    }
+
+    void printUsage(const char* name)
+    {
+        std::fprintf(stderr, "usage: %s [--rate <Hz>] [--block <samples>] [--bpm <tempo>] [--tail <samples>]\n"
+                             "       [--set <paramID>=<value>]... [--pattern \"<pattern>\"]\n", name);
+    }
+}
+
+//==============================================================================
+int main(int argc, char* argv[])
+{
+    Options options;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        auto arg = juce::String(argv[i]);
+        auto hasValue = i + 1 < argc;
+
+        if (arg == "--rate" && hasValue)
+            options.sampleRate = juce::String(argv[++i]).getDoubleValue();
+        else if (arg == "--block" && hasValue)
+            options.blockSize = juce::String(argv[++i]).getIntValue();
+        else if (arg == "--bpm" && hasValue)
+            options.bpm = juce::String(argv[++i]).getDoubleValue();
+        else if (arg == "--tail" && hasValue)
+            options.tail = juce::String(argv[++i]).getLargeIntValue();
+        else if (arg == "--set" && hasValue)
+            options.settings.add(argv[++i]);
+        else if (arg == "--pattern" && hasValue)
+        {
+            options.pattern = argv[++i];
+            options.hasPattern = true;
+        }
+        else
+        {
+            printUsage(argv[0]);
+            return 2;
+        }
+    }
+
+    if (options.sampleRate <= 0.0 || options.blockSize <= 0 || options.bpm <= 0.0 || options.tail < 0)
+    {
+        printUsage(argv[0]);
+        return 2;
+    }
+
+   #if defined(_WIN32)
+    _setmode(_fileno(stdin), _O_BINARY);
+    _setmode(_fileno(stdout), _O_BINARY);
+   #else
+    std::signal(SIGPIPE, SIG_IGN);     // a reader that quits shows up as a failed write instead
+   #endif
+
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;     // the processor's timers and value trees want a message manager
+    Pipe pipe(options);
+
+    for (auto& s : options.settings)
+        if (!applySetting(pipe.getProcessor(), s))
+        {
+            std::fprintf(stderr, "unknown parameter setting: %s\n", s.toRawUTF8());
+            return 2;
+        }
+
+    if (options.hasPattern)
+    {
+        auto result = pipe.getProcessor().setPattern(options.pattern);
+
+        if (result.failed())
+        {
+            std::fprintf(stderr, "pattern: %s\n", result.getErrorMessage().toRawUTF8());
+            return 2;
+        }
+    }
+
+    auto ok = pipe.run();
+
+    if (pipe.getDroppedEvents() > 0)
+        std::fprintf(stderr, "dropped %lld events\n", (long long) pipe.getDroppedEvents());
+
+    return ok ? 0 : 1;
+}